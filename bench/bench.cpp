@@ -0,0 +1,405 @@
+/**
+ * bench.cpp
+ * Headless benchmark for ChordCircle::process(). Built by `make bench`
+ * against bench/rack.hpp and prints one JSON object per scenario (JSON
+ * Lines), so runs can be diffed between releases.
+ *
+ * Usage: chordchemist-bench [samples] [scenario...]
+ */
+
+#include "ChordCircle.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+Plugin* pluginInstance = nullptr;
+
+typedef std::chrono::steady_clock Clock;
+
+static const float SAMPLE_RATE = 48000.f;
+
+struct Scenario {
+    const char* name;
+    void (*setup)(ChordCircle& m);
+    // Sets this sample's inputs, returns true when the sample carries a rising edge.
+    bool (*drive)(ChordCircle& m, int64_t frame);
+};
+
+static void connect(Port& port) {
+    port.channels = 1;
+}
+
+// --- Scenarios ---
+
+static void setupIdle(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+}
+
+static bool driveIdle(ChordCircle& m, int64_t frame) {
+    return false;
+}
+
+static void setupCv(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    connect(m.inputs[ChordCircle::STEPS_CV_INPUT]);
+    connect(m.inputs[ChordCircle::SPREAD_CV_INPUT]);
+    connect(m.inputs[ChordCircle::ROOT_CV_INPUT]);
+    connect(m.inputs[ChordCircle::SCALE_CV_INPUT]);
+}
+
+static bool driveCv(ChordCircle& m, int64_t frame) {
+    // One-second ramps on all four CV inputs, a step every 1024 samples
+    float phase = (frame % 48000) / 48000.f;
+    m.inputs[ChordCircle::STEPS_CV_INPUT].setVoltage(1.f + 15.f * phase);
+    m.inputs[ChordCircle::SPREAD_CV_INPUT].setVoltage(10.f * phase);
+    m.inputs[ChordCircle::ROOT_CV_INPUT].setVoltage(5.f * phase);
+    m.inputs[ChordCircle::SCALE_CV_INPUT].setVoltage(10.f * (1.f - phase));
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage((frame & 1023) >= 512 ? 10.f : 0.f);
+    return (frame & 1023) == 512;
+}
+
+static void setupAudioRateClock(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+}
+
+static bool driveAudioRateClock(ChordCircle& m, int64_t frame) {
+    // Square wave at half the sample rate: a step every other sample
+    bool high = frame & 1;
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(high ? 10.f : 0.f);
+    return high;
+}
+
+// Same as audio_rate_clock on a 16-channel POLY output with a drop voicing
+static void setupAudioRateClockPoly16(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    m.params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    m.numVoices = 16;
+    m.voicingDrop = Voicing::DROP_2;
+}
+
+// Same as audio_rate_clock with the performance counters on; audio_rate_clock
+// itself runs with them off, as every other scenario does
+static void setupAudioRateClockStats(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    m.statsEnabled = true;
+}
+
+static void setupQuantize(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    m.inputs[ChordCircle::QUANTIZE_INPUT].channels = 16;
+}
+
+static bool driveQuantize(ChordCircle& m, int64_t frame) {
+    // 16 detuned saws over two octaves, chord changing every 1024 samples
+    for (int c = 0; c < 16; c++)
+        m.inputs[ChordCircle::QUANTIZE_INPUT].voltages[c] = 2.f * ((frame * (c + 1)) % 4801) / 4801.f - 1.f;
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage((frame & 1023) >= 512 ? 10.f : 0.f);
+    return (frame & 1023) == 512;
+}
+
+static void setupRandomize(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    connect(m.inputs[ChordCircle::RANDOM_CV_INPUT]);
+}
+
+static bool driveRandomize(ChordCircle& m, int64_t frame) {
+    bool high = frame & 1;
+    m.inputs[ChordCircle::RANDOM_CV_INPUT].setVoltage(high ? 10.f : 0.f);
+    return high;
+}
+
+static void setupScaleSweep(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    m.voiceLeading = true;
+}
+
+static bool driveScaleSweep(ChordCircle& m, int64_t frame) {
+    // Every scale and quality in turn, changed half a clock before each edge,
+    // so the per-trigger times show whether the edge cost depends on the chord
+    if ((frame & 1023) == 0) {
+        int64_t beat = frame / 1024;
+        m.params[ChordCircle::SCALE_TYPE_PARAM].setValue((float)(beat % m.library->size()));
+        for (int i = 0; i < 16; i++)
+            m.pattern->qualities[i] = (int)((beat / m.library->size() + i) % NUM_QUALITIES);
+        m.pattern->revision++;
+    }
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage((frame & 1023) >= 512 ? 10.f : 0.f);
+    return (frame & 1023) == 512;
+}
+
+static void setupRootOnEdge(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    connect(m.inputs[ChordCircle::ROOT_CV_INPUT]);
+    m.voiceLeading = true;
+}
+
+// ROOT CV sequenced by the same clock, a new root arriving with each edge:
+// the edge itself has to compute the chord of the lane it steps
+static bool driveRootOnEdge(ChordCircle& m, int64_t frame) {
+    int64_t beat = (frame + 512) / 1024;
+    m.inputs[ChordCircle::ROOT_CV_INPUT].setVoltage((beat * 7 % 24) / 12.f);
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage((frame & 1023) >= 512 ? 10.f : 0.f);
+    return (frame & 1023) == 512;
+}
+
+static void setupLongSequence(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    m.params[ChordCircle::STEPS_COUNT_PARAM].setValue((float)MAX_STEPS);
+    for (int i = 0; i < MAX_STEPS; i++)
+        m.pattern->degrees[i] = (uint8_t)((i * 5) % 7);
+    m.pattern->revision++;
+    m.followPage = true;
+}
+
+// Same clock as audio_rate_clock over all 256 steps, the knob page following
+// the playhead, so page changes and the overview snapshot are in the times
+static bool driveLongSequence(ChordCircle& m, int64_t frame) {
+    bool high = frame & 1;
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(high ? 10.f : 0.f);
+    return high;
+}
+
+static void setupTrackGlide(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    connect(m.inputs[ChordCircle::ROOT_CV_INPUT]);
+    m.voiceLeading = true;
+    m.trackMode = true;
+    m.glideMs = 20.f;
+}
+
+// ROOT CV ramping over all 61 roots every 8192 samples, so the key changes
+// about every 134 samples between clocks every 1024; the glide runs throughout
+static bool driveTrackGlide(ChordCircle& m, int64_t frame) {
+    m.inputs[ChordCircle::ROOT_CV_INPUT].setVoltage(5.f * (frame & 8191) / 8192.f);
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage((frame & 1023) >= 512 ? 10.f : 0.f);
+    return (frame & 1023) == 512;
+}
+
+static void setupClockMultiply(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    m.clockRatioIndex = NUM_CLOCK_RATIOS - 1;   // x4
+}
+
+// Clock every 1024 samples stepping every 256; only the pulses are counted
+// as triggers, the multiplied steps land in ns_per_sample
+static bool driveClockMultiply(ChordCircle& m, int64_t frame) {
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage((frame & 1023) >= 512 ? 10.f : 0.f);
+    return (frame & 1023) == 512;
+}
+
+static void setupMalformedInput(ChordCircle& m) {
+    for (Input& input : m.inputs)
+        connect(input);
+    m.inputs[ChordCircle::CLOCK_INPUT].channels = 4;
+    m.inputs[ChordCircle::QUANTIZE_INPUT].channels = 16;
+    m.inputs[ChordCircle::ANALYZE_INPUT].channels = 4;
+    m.voiceLeading = true;
+    m.trackMode = true;
+}
+
+// Cheap deterministic noise, so every run throws the same values
+static uint32_t hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    return x ^ (x >> 16);
+}
+
+static float noise(int64_t frame, int salt, float range) {
+    return range * ((int32_t)hash((uint32_t)frame * 31 + salt) / 2147483648.f);
+}
+
+// Every input at random voltages far outside +-12V, with NaN and infinity
+// mixed in, and every 256 samples knobs and menu settings out of range too.
+// Measures the all-inputs-moving worst case; with SANITIZE=1 it is a fuzzer.
+// Triggers are lane 1's clock edges, told from the module's own trigger
+// state, since the noise crosses the thresholds at random.
+static bool driveMalformedInput(ChordCircle& m, int64_t frame) {
+    static const float SPECIAL[] = {NAN, INFINITY, -INFINITY, 1e30f, -1e30f};
+    for (int i = 0; i < ChordCircle::INPUTS_LEN; i++) {
+        Input& input = m.inputs[i];
+        for (int c = 0; c < input.channels; c++) {
+            uint32_t h = hash((uint32_t)frame * 977 + i * 16 + c);
+            input.voltages[c] = (h % 61 == 0) ? SPECIAL[h % 5] : noise(frame, i * 16 + c, 100.f);
+        }
+    }
+    if ((frame & 255) == 0) {
+        m.params[ChordCircle::STEPS_COUNT_PARAM].setValue(noise(frame, 1001, 600.f));
+        m.params[ChordCircle::ROOT_NOTE_PARAM].setValue(noise(frame, 1002, 200.f));
+        m.params[ChordCircle::SCALE_TYPE_PARAM].setValue(noise(frame, 1003, 400.f));
+        m.params[ChordCircle::SPREAD_PARAM].setValue(noise(frame, 1004, 3.f));
+        for (int i = 0; i < 16; i++)
+            m.params[ChordCircle::STEP_DEGREE_PARAM_0 + i].setValue(noise(frame, 1010 + i, 20.f));
+        uint32_t h = hash((uint32_t)frame);
+        m.numVoices = 1 + h % Voicing::MAX_VOICES;
+        m.voicingDrop = h / 16 % Voicing::NUM_DROPS;
+        m.voicingExtension = h / 64 % Voicing::NUM_EXTENSIONS;
+        m.clockRatioIndex = h / 128 % NUM_CLOCK_RATIOS;
+        m.strumMode = h / 2048 % StrumScheduler::NUM_MODES;
+        m.page = h / 8192 % NUM_PAGES;
+        m.glideMs = (h & (1 << 20)) ? 5.f : 0.f;
+    }
+    bool high = simd::movemask(m.clockTriggers[0].isHigh()) & 1;
+    return !high && m.inputs[ChordCircle::CLOCK_INPUT].voltages[0] >= 1.f;
+}
+
+static void setupArpeggio(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    m.strumMode = StrumScheduler::MODE_ARPEGGIO;
+    m.strumOrder = StrumScheduler::ORDER_RANDOM;
+    m.strumSync = true;
+}
+
+static bool driveArpeggio(ChordCircle& m, int64_t frame) {
+    // Clock every 1024 samples; 1/8 clock spacing puts a gate event every 64
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage((frame & 1023) >= 512 ? 10.f : 0.f);
+    return (frame & 1023) == 512;
+}
+
+static const Scenario SCENARIOS[] = {
+    {"idle", setupIdle, driveIdle},
+    {"cv", setupCv, driveCv},
+    {"audio_rate_clock", setupAudioRateClock, driveAudioRateClock},
+    {"audio_rate_clock_stats", setupAudioRateClockStats, driveAudioRateClock},
+    {"audio_rate_clock_poly16", setupAudioRateClockPoly16, driveAudioRateClock},
+    {"randomize", setupRandomize, driveRandomize},
+    {"scale_sweep", setupScaleSweep, driveScaleSweep},
+    {"root_on_edge", setupRootOnEdge, driveRootOnEdge},
+    {"quantize_16", setupQuantize, driveQuantize},
+    {"arpeggio", setupArpeggio, driveArpeggio},
+    {"long_sequence", setupLongSequence, driveLongSequence},
+    {"track_glide", setupTrackGlide, driveTrackGlide},
+    {"clock_multiply", setupClockMultiply, driveClockMultiply},
+    {"malformed_input", setupMalformedInput, driveMalformedInput},
+};
+
+// --- Measurement ---
+
+static ChordCircle* createModule(const Scenario& scenario) {
+    ChordCircle* m = new ChordCircle;
+    for (Output& output : m->outputs)
+        connect(output);
+    scenario.setup(*m);
+    return m;
+}
+
+// Stops the run on the first output channel left NaN or infinite
+static void checkFinite(ChordCircle& m, const Scenario& scenario, int64_t frame) {
+    for (int i = 0; i < ChordCircle::OUTPUTS_LEN; i++) {
+        const Output& output = m.outputs[i];
+        for (int c = 0; c < output.channels; c++) {
+            if (std::isfinite(output.voltages[c])) continue;
+            std::fprintf(stderr, "%s: output %d channel %d at %f after sample %lld\n",
+                         scenario.name, i, c + 1, output.voltages[c], (long long)frame);
+            std::exit(1);
+        }
+    }
+}
+
+static double elapsedNs(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double, std::nano>(b - a).count();
+}
+
+static double timerOverheadNs() {
+    std::vector<double> samples(10000);
+    for (double& s : samples) {
+        Clock::time_point t0 = Clock::now();
+        Clock::time_point t1 = Clock::now();
+        s = elapsedNs(t0, t1);
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+static void runScenario(const Scenario& scenario, int64_t numSamples, double timerOverhead) {
+    Module::ProcessArgs args;
+    args.sampleRate = SAMPLE_RATE;
+    args.sampleTime = 1.f / SAMPLE_RATE;
+
+    // Cost of driving the inputs alone, subtracted from the throughput pass
+    ChordCircle* m = createModule(scenario);
+    Clock::time_point t0 = Clock::now();
+    for (int64_t frame = 0; frame < numSamples; frame++)
+        scenario.drive(*m, frame);
+    double driveNs = elapsedNs(t0, Clock::now());
+    delete m;
+
+    // Throughput pass
+    m = createModule(scenario);
+    uint64_t allocsBefore = AllocGuard::getCount();
+    t0 = Clock::now();
+    for (int64_t frame = 0; frame < numSamples; frame++) {
+        scenario.drive(*m, frame);
+        args.frame = frame;
+        m->process(args);
+    }
+    double totalNs = elapsedNs(t0, Clock::now());
+    uint64_t allocs = AllocGuard::getCount() - allocsBefore;
+    delete m;
+
+    // Per-trigger pass: only samples carrying an edge are timed individually,
+    // and every sample's outputs are checked outside the timings
+    m = createModule(scenario);
+    std::vector<double> triggerNs;
+    triggerNs.reserve(numSamples / 2 + 1);
+    for (int64_t frame = 0; frame < numSamples; frame++) {
+        bool edge = scenario.drive(*m, frame);
+        args.frame = frame;
+        if (edge) {
+            Clock::time_point t = Clock::now();
+            m->process(args);
+            triggerNs.push_back(std::max(elapsedNs(t, Clock::now()) - timerOverhead, 0.0));
+        }
+        else {
+            m->process(args);
+        }
+        checkFinite(*m, scenario, frame);
+    }
+    delete m;
+
+    double p50 = 0.0, p99 = 0.0, worst = 0.0;
+    if (!triggerNs.empty()) {
+        std::sort(triggerNs.begin(), triggerNs.end());
+        p50 = triggerNs[triggerNs.size() / 2];
+        p99 = triggerNs[std::min(triggerNs.size() - 1, triggerNs.size() * 99 / 100)];
+        worst = triggerNs.back();
+    }
+
+#ifdef CHORDCHEMIST_ALLOC_GUARD
+    const char* allocGuard = "true";
+#else
+    const char* allocGuard = "false";
+#endif
+    std::printf("{\"scenario\": \"%s\", \"samples\": %lld, \"ns_per_sample\": %.3f, "
+        "\"triggers\": %zu, \"trigger_p50_ns\": %.1f, \"trigger_p99_ns\": %.1f, \"trigger_max_ns\": %.1f, "
+        "\"alloc_guard\": %s, \"allocations\": %llu}\n",
+        scenario.name, (long long)numSamples, std::max(totalNs - driveNs, 0.0) / numSamples,
+        triggerNs.size(), p50, p99, worst,
+        allocGuard, (unsigned long long)allocs);
+    std::fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    int64_t numSamples = 4000000;
+    if (argc > 1) numSamples = std::max(std::atoll(argv[1]), 1LL);
+
+    // Scenarios named after the sample count, or all of them
+    std::vector<const Scenario*> selected;
+    for (const Scenario& scenario : SCENARIOS) {
+        bool named = argc <= 2;
+        for (int i = 2; i < argc; i++)
+            named = named || std::strcmp(argv[i], scenario.name) == 0;
+        if (named) selected.push_back(&scenario);
+    }
+    if ((int)selected.size() < std::max(argc - 2, 1)) {
+        std::fprintf(stderr, "unknown scenario\n");
+        return 1;
+    }
+
+    double timerOverhead = timerOverheadNs();
+    for (const Scenario* scenario : selected)
+        runScenario(*scenario, numSamples, timerOverhead);
+    return 0;
+}
@@ -0,0 +1,47 @@
+# Headless benchmark and tests for ChordCircle::process(), included by the
+# top-level Makefile for `make bench` and `make test`. Builds against
+# bench/rack.hpp instead of the Rack SDK, so RACK_DIR is not needed.
+#
+#   make bench                    run all scenarios, JSON Lines on stdout
+#   make bench BENCH_SAMPLES=N    samples per scenario (default 4000000)
+#   make bench BENCH_SCENARIOS="idle cv"   only these scenarios
+#   make bench ALLOC_GUARD=1      also count audio-thread allocations
+#   make bench SANITIZE=1         build with ASan and UBSan; timings are then
+#                                 meaningless, but malformed_input turns into
+#                                 a fuzz run that stops on the first bad index
+#                                 (every run stops on a NaN or infinite output)
+#   make test                     golden runs, checks and cost limits
+#                                 (bench/test.cpp), then malformed_input as a
+#                                 sanitized fuzz run
+#   make test UPDATE_GOLDEN=1     rewrite bench/golden from this build
+
+BENCH_BIN := bench/build/chordchemist-bench$(if $(ALLOC_GUARD),-allocguard)$(if $(SANITIZE),-sanitize)
+BENCH_SOURCES := bench/bench.cpp src/AllocGuard.cpp src/ChordRecognizer.cpp src/Quantizer.cpp src/HarmonyBus.cpp src/ScaleLibrary.cpp src/Tuning.cpp
+BENCH_SAMPLES ?= 4000000
+BENCH_SCENARIOS ?=
+BENCH_CXXFLAGS := -std=c++11 -O3 -funsafe-math-optimizations -Wall -Ibench -Isrc
+ifdef SANITIZE
+BENCH_CXXFLAGS += -O1 -g -fno-omit-frame-pointer -fsanitize=address,undefined,float-cast-overflow -fno-sanitize-recover=all
+endif
+
+$(BENCH_BIN): $(BENCH_SOURCES) bench/rack.hpp $(wildcard src/*.hpp)
+	@mkdir -p $(dir $@)
+	$(CXX) $(BENCH_CXXFLAGS) $(FLAGS) $(BENCH_SOURCES) -o $@
+
+.PHONY: bench
+bench: $(BENCH_BIN)
+	@$(BENCH_BIN) $(BENCH_SAMPLES) $(BENCH_SCENARIOS)
+
+TEST_BIN := bench/build/chordchemist-test$(if $(SANITIZE),-sanitize)
+TEST_SOURCES := bench/test.cpp $(filter-out bench/bench.cpp,$(BENCH_SOURCES))
+# Enough for every malformed value to reach every input many times over
+TEST_FUZZ_SAMPLES ?= 200000
+
+$(TEST_BIN): $(TEST_SOURCES) bench/rack.hpp $(wildcard src/*.hpp)
+	@mkdir -p $(dir $@)
+	$(CXX) $(BENCH_CXXFLAGS) $(FLAGS) $(TEST_SOURCES) -o $@
+
+.PHONY: test
+test: $(TEST_BIN)
+	@$(TEST_BIN) bench/golden $(if $(UPDATE_GOLDEN),--update)
+	@$(MAKE) --no-print-directory bench SANITIZE=1 BENCH_SAMPLES=$(TEST_FUZZ_SAMPLES) BENCH_SCENARIOS=malformed_input
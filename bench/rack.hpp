@@ -0,0 +1,378 @@
+#pragma once
+/**
+ * bench/rack.hpp
+ * Minimal stand-in for the module side of the Rack SDK (Module, Port, Param,
+ * dsp, simd), so ChordCircle.hpp can be built and timed without Rack.
+ * Only what the module uses is here; widget types are deliberately absent.
+ * JSON values live in memory only, for the save/load tests.
+ */
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+
+// In-memory JSON values with jansson's interface, enough for dataToJson()
+// and dataFromJson() round trips in the tests. Files are never read or written.
+enum json_type { JSON_OBJECT, JSON_ARRAY, JSON_STRING, JSON_INTEGER, JSON_REAL, JSON_TRUE, JSON_FALSE };
+typedef long long json_int_t;
+struct json_t {
+	json_type type;
+	json_int_t integer = 0;
+	double real = 0.0;
+	std::string string;
+	std::vector<std::pair<std::string, json_t*>> members;
+	std::vector<json_t*> items;
+	explicit json_t(json_type type) : type(type) {}
+	~json_t() {
+		for (auto& member : members) delete member.second;
+		for (json_t* item : items) delete item;
+	}
+};
+inline json_t* json_object() { return new json_t(JSON_OBJECT); }
+inline json_t* json_array() { return new json_t(JSON_ARRAY); }
+inline json_t* json_integer(json_int_t v) { json_t* j = new json_t(JSON_INTEGER); j->integer = v; return j; }
+inline json_t* json_real(double v) { json_t* j = new json_t(JSON_REAL); j->real = v; return j; }
+inline json_t* json_string(const char* v) { if (!v) return nullptr; json_t* j = new json_t(JSON_STRING); j->string = v; return j; }
+inline json_t* json_boolean(bool v) { return new json_t(v ? JSON_TRUE : JSON_FALSE); }
+inline void json_decref(json_t* j) { delete j; }
+inline int json_object_set_new(json_t* object, const char* key, json_t* value) {
+	if (!object || object->type != JSON_OBJECT || !value) { delete value; return -1; }
+	for (auto& member : object->members)
+		if (member.first == key) { delete member.second; member.second = value; return 0; }
+	object->members.push_back(std::make_pair(std::string(key), value));
+	return 0;
+}
+inline json_t* json_object_get(const json_t* object, const char* key) {
+	if (!object || object->type != JSON_OBJECT) return nullptr;
+	for (auto& member : object->members)
+		if (member.first == key) return member.second;
+	return nullptr;
+}
+inline int json_array_append_new(json_t* array, json_t* value) {
+	if (!array || array->type != JSON_ARRAY || !value) { delete value; return -1; }
+	array->items.push_back(value);
+	return 0;
+}
+inline size_t json_array_size(const json_t* array) { return (array && array->type == JSON_ARRAY) ? array->items.size() : 0; }
+inline json_t* json_array_get(const json_t* array, size_t i) { return i < json_array_size(array) ? array->items[i] : nullptr; }
+inline json_int_t json_integer_value(const json_t* j) { return (j && j->type == JSON_INTEGER) ? j->integer : 0; }
+inline double json_real_value(const json_t* j) { return (j && j->type == JSON_REAL) ? j->real : 0.0; }
+inline double json_number_value(const json_t* j) { return (j && j->type == JSON_INTEGER) ? (double) j->integer : json_real_value(j); }
+inline const char* json_string_value(const json_t* j) { return (j && j->type == JSON_STRING) ? j->string.c_str() : nullptr; }
+inline bool json_is_true(const json_t* j) { return j && j->type == JSON_TRUE; }
+inline bool json_is_array(const json_t* j) { return j && j->type == JSON_ARRAY; }
+inline bool json_is_object(const json_t* j) { return j && j->type == JSON_OBJECT; }
+inline bool json_is_string(const json_t* j) { return j && j->type == JSON_STRING; }
+inline bool json_is_number(const json_t* j) { return j && (j->type == JSON_INTEGER || j->type == JSON_REAL); }
+struct json_error_t { char text[160]; int line; };
+inline json_t* json_loadf(FILE*, size_t, json_error_t* error) { if (error) { std::snprintf(error->text, sizeof(error->text), "not supported in the bench"); error->line = 0; } return nullptr; }
+inline json_t* json_load_file(const char* path, size_t flags, json_error_t* error) { return json_loadf(nullptr, flags, error); }
+inline int json_dumpf(const json_t*, FILE*, size_t) { return -1; }
+inline int json_dump_file(const json_t*, const char*, size_t) { return -1; }
+#define JSON_INDENT(n) 0
+#define JSON_REAL_PRECISION(n) 0
+#define json_array_foreach(array, index, value) \
+	for (index = 0; index < json_array_size(array) && (value = json_array_get(array, index)); index++)
+#define json_object_foreach(object, key, value) \
+	for (size_t json_i_ = 0; json_i_ < (json_is_object(object) ? (object)->members.size() : 0) && ((key = (object)->members[json_i_].first.c_str()), (value = (object)->members[json_i_].second)); json_i_++)
+
+#define DEBUG(...) do {} while (0)
+#define INFO(...) do {} while (0)
+#define WARN(...) do {} while (0)
+
+namespace rack {
+
+namespace simd {
+// GCC/Clang vector extensions, so float_4 code compiles to SIMD like Rack's SSE type.
+typedef float v4sf __attribute__((vector_size(16)));
+typedef int32_t v4si __attribute__((vector_size(16)));
+
+struct float_4 {
+	v4sf v;
+	float_4() {}
+	float_4(v4sf v) : v(v) {}
+	float_4(float x) { v = (v4sf) {x, x, x, x}; }
+	float_4(float a, float b, float c, float d) { v = (v4sf) {a, b, c, d}; }
+	static float_4 zero() { return float_4(0.f); }
+	static float_4 load(const float* p) { float_4 r; std::memcpy(&r.v, p, sizeof(r.v)); return r; }
+	void store(float* p) const { std::memcpy(p, &v, sizeof(v)); }
+	static float_4 mask() { return float_4((v4sf) ((v4si) {-1, -1, -1, -1})); }
+	float& operator[](int i) { return reinterpret_cast<float*>(&v)[i]; }
+	const float& operator[](int i) const { return reinterpret_cast<const float*>(&v)[i]; }
+};
+
+#define BENCH_ARITH(op) \
+	inline float_4 operator op(const float_4& a, const float_4& b) { return float_4(a.v op b.v); } \
+	inline float_4& operator op##=(float_4& a, const float_4& b) { a.v = a.v op b.v; return a; }
+BENCH_ARITH(+) BENCH_ARITH(-) BENCH_ARITH(*) BENCH_ARITH(/)
+#undef BENCH_ARITH
+inline float_4 operator-(const float_4& a) { return float_4(-a.v); }
+
+#define BENCH_BITS(op) \
+	inline float_4 operator op(const float_4& a, const float_4& b) { return float_4((v4sf) ((v4si) a.v op (v4si) b.v)); } \
+	inline float_4& operator op##=(float_4& a, const float_4& b) { a = a op b; return a; }
+BENCH_BITS(&) BENCH_BITS(|) BENCH_BITS(^)
+#undef BENCH_BITS
+inline float_4 operator~(const float_4& a) { return float_4((v4sf) (~(v4si) a.v)); }
+
+#define BENCH_CMP(op) \
+	inline float_4 operator op(const float_4& a, const float_4& b) { return float_4((v4sf) (a.v op b.v)); }
+BENCH_CMP(<) BENCH_CMP(>) BENCH_CMP(<=) BENCH_CMP(>=) BENCH_CMP(==) BENCH_CMP(!=)
+#undef BENCH_CMP
+
+inline int movemask(const float_4& a) {
+	v4si s = (v4si) a.v;
+	return (s[0] < 0) | ((s[1] < 0) << 1) | ((s[2] < 0) << 2) | ((s[3] < 0) << 3);
+}
+inline float_4 ifelse(const float_4& m, const float_4& a, const float_4& b) { return (m & a) | (~m & b); }
+inline float_4 fmin(const float_4& a, const float_4& b) { return ifelse(a < b, a, b); }
+inline float_4 fmax(const float_4& a, const float_4& b) { return ifelse(a > b, a, b); }
+inline float_4 fabs(const float_4& a) { return float_4((v4sf) ((v4si) a.v & (v4si) {0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff})); }
+inline float_4 clamp(const float_4& x, const float_4& a, const float_4& b) { return fmin(fmax(x, a), b); }
+inline float_4 round(const float_4& a) { float_4 r; for (int i = 0; i < 4; i++) r[i] = std::nearbyint(a[i]); return r; }
+inline float_4 floor(const float_4& a) { float_4 r; for (int i = 0; i < 4; i++) r[i] = std::floor(a[i]); return r; }
+inline float round(float x) { return std::round(x); }
+inline float floor(float x) { return std::floor(x); }
+inline float clamp(float x, float a, float b) { return std::fmin(std::fmax(x, a), b); }
+inline float ifelse(bool m, float a, float b) { return m ? a : b; }
+} // namespace simd
+
+inline int clamp(int x, int a, int b) { return std::max(std::min(x, b), a); }
+inline float clamp(float x, float a = 0.f, float b = 1.f) { return std::fmax(std::fmin(x, b), a); }
+inline float rescale(float x, float xMin, float xMax, float yMin, float yMax) { return yMin + (x - xMin) / (xMax - xMin) * (yMax - yMin); }
+inline int eucMod(int a, int b) { int m = a % b; if (m < 0) m += b; return m; }
+inline int eucDiv(int a, int b) { int d = a / b; if (d * b != a && (a < 0) != (b < 0)) d--; return d; }
+
+namespace string {
+inline std::string f(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+inline std::string f(const char* fmt, ...) { char buf[1024]; va_list ap; va_start(ap, fmt); vsnprintf(buf, sizeof(buf), fmt, ap); va_end(ap); return buf; }
+}
+
+namespace random {
+inline std::mt19937& benchGen() { static std::mt19937 g(1); return g; }
+inline float uniform() { return std::uniform_real_distribution<float>(0.f, 1.f)(benchGen()); }
+inline float normal() { return std::normal_distribution<float>(0.f, 1.f)(benchGen()); }
+inline uint32_t u32() { return benchGen()(); }
+inline uint64_t u64() { return ((uint64_t) benchGen()() << 32) | benchGen()(); }
+}
+
+namespace system {
+inline double getTime() { return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+inline bool exists(const std::string&) { return false; }
+inline bool isFile(const std::string&) { return false; }
+inline bool createDirectories(const std::string&) { return true; }
+inline std::string join(const std::string& a, const std::string& b) { return a + "/" + b; }
+inline std::string getFilename(const std::string& p) { return p; }
+inline std::string getStem(const std::string& p) { return p; }
+}
+
+namespace dsp {
+static const float FREQ_C4 = 261.6256f;
+template <typename T = float>
+struct TSchmittTrigger {
+	T state = T::mask();
+	void reset() { state = T::mask(); }
+	T process(T in, T offThreshold = 0.f, T onThreshold = 1.f) {
+		T on = (in >= onThreshold);
+		T off = (in <= offThreshold);
+		T triggered = ~state & on;
+		state = on | (state & ~off);
+		return triggered;
+	}
+	T isHigh() { return state; }
+};
+template <>
+struct TSchmittTrigger<float> {
+	bool state = true;
+	void reset() { state = true; }
+	bool process(float in, float offThreshold = 0.f, float onThreshold = 1.f) {
+		if (state) { if (in <= offThreshold) state = false; }
+		else if (in >= onThreshold) { state = true; return true; }
+		return false;
+	}
+	bool isHigh() { return state; }
+};
+typedef TSchmittTrigger<> SchmittTrigger;
+
+struct ClockDivider {
+	uint32_t clock = 0;
+	uint32_t division = 1;
+	void reset() { clock = 0; }
+	void setDivision(uint32_t d) { division = d; }
+	uint32_t getDivision() { return division; }
+	uint32_t getClock() { return clock; }
+	bool process() { if (++clock >= division) { clock = 0; return true; } return false; }
+};
+
+struct PulseGenerator {
+	float remaining = 0.f;
+	void reset() { remaining = 0.f; }
+	bool process(float deltaTime) { if (remaining > 0.f) { remaining -= deltaTime; return true; } return false; }
+	void trigger(float duration = 1e-3f) { if (duration > remaining) remaining = duration; }
+};
+
+template <typename T = float>
+struct TSlewLimiter {
+	T out = 0.f;
+	T rise = 0.f;
+	T fall = 0.f;
+	void reset() { out = 0.f; }
+	void setRiseFall(T rise, T fall) { this->rise = rise; this->fall = fall; }
+	T process(T deltaTime, T in) { out = simd::clamp(in, out - fall * deltaTime, out + rise * deltaTime); return out; }
+};
+typedef TSlewLimiter<> SlewLimiter;
+} // namespace dsp
+
+namespace engine {
+static const int PORT_MAX_CHANNELS = 16;
+
+struct Param {
+	float value = 0.f;
+	float getValue() { return value; }
+	void setValue(float v) { value = v; }
+};
+
+struct Port {
+	union { float voltages[PORT_MAX_CHANNELS] = {}; float value; };
+	uint8_t channels = 0;
+	float getVoltage(int c = 0) { return voltages[c]; }
+	void setVoltage(float v, int c = 0) { voltages[c] = v; }
+	float getPolyVoltage(int c) { return isMonophonic() ? getVoltage(0) : getVoltage(c); }
+	float getVoltageSum() { float s = 0.f; for (int c = 0; c < channels; c++) s += voltages[c]; return s; }
+	template <typename T> T getVoltageSimd(int firstChannel) { return T::load(&voltages[firstChannel]); }
+	template <typename T> T getPolyVoltageSimd(int firstChannel) { return isMonophonic() ? T(getVoltage(0)) : getVoltageSimd<T>(firstChannel); }
+	template <typename T> void setVoltageSimd(T v, int firstChannel) { v.store(&voltages[firstChannel]); }
+	void readVoltages(float* v) { for (int c = 0; c < channels; c++) v[c] = voltages[c]; }
+	void writeVoltages(const float* v) { for (int c = 0; c < channels; c++) voltages[c] = v[c]; }
+	void clearVoltages() { for (int c = 0; c < channels; c++) voltages[c] = 0.f; }
+	int getChannels() { return channels; }
+	bool isConnected() { return channels > 0; }
+	bool isMonophonic() { return channels == 1; }
+	bool isPolyphonic() { return channels > 1; }
+	// As in Rack: channels above n are zeroed, and 0 leaves one silent channel
+	void setChannels(int n) {
+		if (channels == 0) return;
+		for (int c = std::max(n, 0); c < channels; c++) voltages[c] = 0.f;
+		channels = (uint8_t) clamp(n, 1, PORT_MAX_CHANNELS);
+	}
+};
+struct Output : Port {};
+struct Input : Port {};
+
+struct Light {
+	float value = 0.f;
+	void setBrightness(float b) { value = b; }
+	float getBrightness() { return value; }
+	void setBrightnessSmooth(float b, float) { value = b; }
+};
+
+struct ParamQuantity {
+	float minValue = 0.f, maxValue = 1.f, defaultValue = 0.f;
+	std::string name;
+	bool snapEnabled = false;
+	bool smoothEnabled = true;
+	bool randomizeEnabled = true;
+	Param* param = nullptr;
+	virtual ~ParamQuantity() {}
+	float getValue() { return param ? param->value : 0.f; }
+	void setValue(float v) { if (param) param->value = v; }
+	float getMinValue() { return minValue; }
+	float getMaxValue() { return maxValue; }
+	virtual std::string getDisplayValueString() { return std::to_string(getValue()); }
+};
+struct PortInfo { std::string name; virtual ~PortInfo() {} };
+
+struct Module;
+struct Model { std::string slug; };
+
+struct Module {
+	int64_t id = 0;
+	Model* model = nullptr;
+	std::vector<Param> params;
+	std::vector<Input> inputs;
+	std::vector<Output> outputs;
+	std::vector<Light> lights;
+	std::vector<ParamQuantity*> paramQuantities;
+
+	struct Expander {
+		int64_t moduleId = -1;
+		Module* module = nullptr;
+		void* producerMessage = nullptr;
+		void* consumerMessage = nullptr;
+		bool messageFlipRequested = false;
+		void requestMessageFlip() { messageFlipRequested = true; }
+	};
+	Expander leftExpander;
+	Expander rightExpander;
+
+	struct ProcessArgs { float sampleRate; float sampleTime; int64_t frame; };
+	struct SampleRateChangeEvent { float sampleRate; float sampleTime; };
+	struct AddEvent {};
+	struct RemoveEvent {};
+	struct ResetEvent {};
+	struct RandomizeEvent {};
+
+	virtual ~Module() { for (ParamQuantity* pq : paramQuantities) delete pq; }
+	void config(int numParams, int numInputs, int numOutputs, int numLights = 0) {
+		params.resize(numParams); inputs.resize(numInputs); outputs.resize(numOutputs); lights.resize(numLights);
+		paramQuantities.resize(numParams, nullptr);
+	}
+	template <class TParamQuantity = ParamQuantity>
+	TParamQuantity* configParam(int paramId, float minValue, float maxValue, float defaultValue, std::string name = "", std::string unit = "", float displayBase = 0.f, float displayMultiplier = 1.f, float displayOffset = 0.f) {
+		delete paramQuantities[paramId];
+		TParamQuantity* q = new TParamQuantity;
+		q->minValue = minValue; q->maxValue = maxValue; q->defaultValue = defaultValue; q->name = name;
+		q->param = &params[paramId];
+		paramQuantities[paramId] = q;
+		params[paramId].value = defaultValue;
+		return q;
+	}
+	template <class TSwitchQuantity = ParamQuantity>
+	TSwitchQuantity* configSwitch(int paramId, float minValue, float maxValue, float defaultValue, std::string name = "", std::vector<std::string> labels = {}) {
+		return configParam<TSwitchQuantity>(paramId, minValue, maxValue, defaultValue, name);
+	}
+	template <class TParamQuantity = ParamQuantity>
+	TParamQuantity* configButton(int paramId, std::string name = "") { return configParam<TParamQuantity>(paramId, 0.f, 1.f, 0.f, name); }
+	template <class TPortInfo = PortInfo>
+	TPortInfo* configInput(int, std::string = "") { return nullptr; }
+	template <class TPortInfo = PortInfo>
+	TPortInfo* configOutput(int, std::string = "") { return nullptr; }
+	void configBypass(int, int) {}
+
+	virtual void process(const ProcessArgs&) {}
+	virtual json_t* dataToJson() { return nullptr; }
+	virtual void dataFromJson(json_t*) {}
+	virtual void onReset(const ResetEvent&) {}
+	virtual void onRandomize(const RandomizeEvent&) {}
+	virtual void onAdd(const AddEvent&) {}
+	virtual void onRemove(const RemoveEvent&) {}
+	virtual void onSampleRateChange(const SampleRateChangeEvent&) {}
+	virtual void onExpanderChange(const struct ExpanderChangeEvent&) {}
+};
+struct ExpanderChangeEvent { bool side; };
+} // namespace engine
+
+using namespace engine;
+using engine::Module;
+using engine::Model;
+using engine::ParamQuantity;
+using engine::PORT_MAX_CHANNELS;
+
+struct Model;
+struct Plugin { std::string slug; std::string path; void addModel(engine::Model*) {} };
+
+namespace asset {
+inline std::string user(std::string filename = "") { return "/tmp/chordchemist-user/" + filename; }
+inline std::string plugin(Plugin*, std::string filename = "") { return filename; }
+}
+
+} // namespace rack
@@ -0,0 +1,1657 @@
+/**
+ * test.cpp
+ * Regression tests for ChordCircle, built and run by `make test` against
+ * bench/rack.hpp like the bench. Golden runs play scripted clock, CV and
+ * param streams through process() and compare VOICE 1-4 and POLY on every
+ * sample with the files in bench/golden. Checks test one feature each
+ * against a reference computed here, and the cost of process() against a
+ * reference timed in the same run.
+ *
+ * Usage: chordchemist-test [golden dir] [--update]
+ *   --update   rewrite the golden files from this build instead of comparing
+ */
+
+#include "ChordCircle.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <string>
+#include <vector>
+
+Plugin* pluginInstance = nullptr;
+
+static const float SAMPLE_RATE = 48000.f;
+
+// --- Checks ---
+
+static int numChecks = 0;
+static int numFailures = 0;
+
+// Counts the check and reports it when it failed. Returns `ok`, so a loop
+// can stop at its first failure instead of reporting thousands.
+static bool check(bool ok, const char* file, int line, const char* format, ...) __attribute__((format(printf, 4, 5)));
+static bool check(bool ok, const char* file, int line, const char* format, ...) {
+    numChecks++;
+    if (ok) return true;
+    numFailures++;
+    std::fprintf(stderr, "%s:%d: FAIL: ", file, line);
+    va_list args;
+    va_start(args, format);
+    std::vfprintf(stderr, format, args);
+    va_end(args);
+    std::fprintf(stderr, "\n");
+    return false;
+}
+
+#define CHECK(ok, ...) check((ok), __FILE__, __LINE__, __VA_ARGS__)
+
+// --- Module helpers ---
+
+static void connect(Port& port, int channels = 1) {
+    port.channels = channels;
+}
+
+// Every output patched, both PRNGs seeded, so runs repeat exactly.
+static ChordCircle* createModule() {
+    ChordCircle* m = new ChordCircle;
+    for (Output& output : m->outputs)
+        connect(output);
+    m->randomizer.setSeed(1);
+    m->strum.rng.setSeed(2);
+    return m;
+}
+
+static void process(ChordCircle& m, int64_t frame) {
+    Module::ProcessArgs args;
+    args.sampleRate = SAMPLE_RATE;
+    args.sampleTime = 1.f / SAMPLE_RATE;
+    args.frame = frame;
+    m.process(args);
+}
+
+// Square wave, low for the first half of each period: rising edges at
+// period / 2, 3 * period / 2, ...
+static float getClock(int64_t frame, int period) {
+    return (frame % period) >= period / 2 ? 10.f : 0.f;
+}
+
+// Runs up to sample `to` with a clock of `period` on CLOCK_INPUT.
+static void runClock(ChordCircle& m, int64_t& frame, int64_t to, int period) {
+    for (; frame < to; frame++) {
+        m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, period));
+        process(m, frame);
+    }
+}
+
+// A step of a pattern in root position, from the table, at the module's
+// root and scale knobs
+static void getChord(ChordCircle& m, const Pattern& p, int step, float out[4]) {
+    int root = (int)m.params[ChordCircle::ROOT_NOTE_PARAM].getValue();
+    int scale = (int)m.params[ChordCircle::SCALE_TYPE_PARAM].getValue();
+    const ChordEntry& chord = m.library->getChord(scale, p.degrees[step], p.qualities[step]);
+    for (int k = 0; k < 4; k++)
+        out[k] = m.library->rootVoltages[root] + chord.voltages[k];
+}
+
+// What Rack's engine does for the right expander at the end of each sample
+static void flipMessages(Module& m) {
+    Module::Expander& expander = m.rightExpander;
+    if (!expander.messageFlipRequested) return;
+    std::swap(expander.producerMessage, expander.consumerMessage);
+    expander.messageFlipRequested = false;
+}
+
+static bool isPlaying(ChordCircle& m, const float voltages[4]) {
+    for (int k = 0; k < 4; k++)
+        if (std::fabs(m.outputs[ChordCircle::VOICE_1_OUTPUT + k].getVoltage() - voltages[k]) > 1e-5f) return false;
+    return true;
+}
+
+// --- Golden runs ---
+
+struct Script {
+    const char* name;
+    int64_t numSamples;
+    void (*setup)(ChordCircle& m);
+    void (*drive)(ChordCircle& m, int64_t frame);
+};
+
+// Scale 3 is Major (Ionian); qualities cycle so every extension is heard.
+static void setupSequence(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    m.params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    m.params[ChordCircle::STEPS_COUNT_PARAM].setValue(12.f);
+    for (int i = 0; i < MAX_STEPS; i++)
+        m.pattern->qualities[i] = i % NUM_QUALITIES;
+    m.pattern->revision++;
+}
+
+// Open voicing halfway, then a step knob moved
+static void driveSequence(ChordCircle& m, int64_t frame) {
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, 960));
+    if (frame == 12000) m.params[ChordCircle::SPREAD_PARAM].setValue(1.f);
+    if (frame == 18000) m.params[ChordCircle::STEP_DEGREE_PARAM_0 + 2].setValue(5.f);
+}
+
+static void setupCv(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    connect(m.inputs[ChordCircle::STEPS_CV_INPUT]);
+    connect(m.inputs[ChordCircle::SPREAD_CV_INPUT]);
+    connect(m.inputs[ChordCircle::ROOT_CV_INPUT]);
+    connect(m.inputs[ChordCircle::SCALE_CV_INPUT]);
+}
+
+// Slow ramps on the four motorized CVs, spread rising then falling
+static void driveCv(ChordCircle& m, int64_t frame) {
+    float phase = frame / 48000.f;
+    m.inputs[ChordCircle::STEPS_CV_INPUT].setVoltage(1.f + 15.f * phase);
+    m.inputs[ChordCircle::SPREAD_CV_INPUT].setVoltage(10.f * (1.f - std::fabs(2.f * phase - 1.f)));
+    m.inputs[ChordCircle::ROOT_CV_INPUT].setVoltage(1.f + 2.f * phase);
+    m.inputs[ChordCircle::SCALE_CV_INPUT].setVoltage(10.f * (1.f - phase));
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, 1024));
+}
+
+static void setupVoiceLeading(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    connect(m.inputs[ChordCircle::RESET_INPUT]);
+    m.params[ChordCircle::STEPS_COUNT_PARAM].setValue(7.f);
+    m.voiceLeading = true;
+    for (int i = 0; i < MAX_STEPS; i++)
+        m.pattern->qualities[i] = (i * 3) % NUM_QUALITIES;
+    m.pattern->revision++;
+}
+
+// A new scale every 4 clocks, a reset every 11, open voicing (bass kept)
+// for the second half
+static void driveVoiceLeading(ChordCircle& m, int64_t frame) {
+    int64_t beat = frame / 800;
+    m.params[ChordCircle::SCALE_TYPE_PARAM].setValue((float)(beat / 4 * 5 % m.library->size()));
+    m.params[ChordCircle::SPREAD_PARAM].setValue(frame >= 20000 ? 1.f : 0.f);
+    m.inputs[ChordCircle::RESET_INPUT].setVoltage(beat % 11 == 10 && frame % 800 < 100 ? 10.f : 0.f);
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, 800));
+}
+
+static void setupStrum(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    m.params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    m.strumMode = StrumScheduler::MODE_STRUM;
+    m.strumOrder = StrumScheduler::ORDER_DOWN;
+    m.strumMs = 2.f;
+}
+
+// Strummed down, then arpeggiated in random order at 1/8 of the clock
+static void driveStrum(ChordCircle& m, int64_t frame) {
+    if (frame == 7200) {
+        m.strumMode = StrumScheduler::MODE_ARPEGGIO;
+        m.strumOrder = StrumScheduler::ORDER_RANDOM;
+        m.strumSync = true;
+    }
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, 1200));
+}
+
+static void setupTrackGlide(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    connect(m.inputs[ChordCircle::ROOT_CV_INPUT]);
+    m.voiceLeading = true;
+    m.trackMode = true;
+    m.glideMs = 0.25f;
+}
+
+// ROOT CV up a whole tone every 3000 samples, between clocks every 4000
+static void driveTrackGlide(ChordCircle& m, int64_t frame) {
+    m.inputs[ChordCircle::ROOT_CV_INPUT].setVoltage(1.f + (frame / 3000 % 4) * 2.f / 12.f);
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, 4000));
+}
+
+static void setupPoly16(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    m.params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    for (int i = 0; i < MAX_STEPS; i++)
+        m.pattern->qualities[i] = (i * 2) % NUM_QUALITIES;
+    m.pattern->revision++;
+    m.numVoices = 16;
+    m.voicingDrop = Voicing::DROP_2;
+}
+
+// 16 voices of stacked thirds dropped 2, then octaves dropped 3, then 7 voices
+static void drivePoly16(ChordCircle& m, int64_t frame) {
+    if (frame == 7200) {
+        m.voicingExtension = Voicing::EXTEND_OCTAVES;
+        m.voicingDrop = Voicing::DROP_3;
+    }
+    if (frame == 14400) {
+        m.numVoices = 7;
+        m.voicingExtension = Voicing::EXTEND_THIRDS;
+        m.voicingDrop = Voicing::DROP_NONE;
+    }
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, 900));
+}
+
+static void setupClockRatio(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    m.clockRatioIndex = NUM_CLOCK_RATIOS - 2;   // x3
+}
+
+// Three steps per clock, then one every second clock
+static void driveClockRatio(ChordCircle& m, int64_t frame) {
+    if (frame == 15000) m.clockRatioIndex = DEFAULT_CLOCK_RATIO - 1;   // /2
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, 3000));
+}
+
+static void setupPatterns(ChordCircle& m) {
+    connect(m.inputs[ChordCircle::CLOCK_INPUT]);
+    connect(m.inputs[ChordCircle::PATTERN_CV_INPUT]);
+    m.params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    m.params[ChordCircle::STEPS_COUNT_PARAM].setValue(32.f);
+    m.followPage = true;
+    for (int p = 1; p < 3; p++) {
+        for (int i = 0; i < MAX_STEPS; i++) {
+            m.patterns[p].degrees[i] = (i * (p + 2)) % NUM_DEGREES;
+            m.patterns[p].qualities[i] = (i + p) % NUM_QUALITIES;
+        }
+        m.patterns[p].revision++;
+    }
+}
+
+// PATTERN CV on patterns 0, 1, 2, 1 for ten clocks each, 32 steps over two
+// knob pages
+static void drivePatterns(ChordCircle& m, int64_t frame) {
+    static const int ORDER[4] = {0, 1, 2, 1};
+    int p = ORDER[frame / 6000 % 4];
+    m.inputs[ChordCircle::PATTERN_CV_INPUT].setVoltage((p + 0.5f) * 10.f / (NUM_PATTERNS - 1));
+    m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, 600));
+}
+
+static const Script SCRIPTS[] = {
+    {"sequence", 24000, setupSequence, driveSequence},
+    {"cv", 48000, setupCv, driveCv},
+    {"voice_leading", 40000, setupVoiceLeading, driveVoiceLeading},
+    {"strum", 14400, setupStrum, driveStrum},
+    {"track_glide", 12000, setupTrackGlide, driveTrackGlide},
+    {"poly16", 21600, setupPoly16, drivePoly16},
+    {"clock_ratio", 30000, setupClockRatio, driveClockRatio},
+    {"patterns", 24000, setupPatterns, drivePatterns},
+};
+
+// Outputs within this of the golden value pass, so the files survive
+// compilers and optimization levels. 0.1 mV is about 0.1 cent.
+static const float GOLDEN_TOLERANCE = 1e-4f;
+
+// VOICE 1-4 and POLY after one sample. A golden file holds a row for every
+// sample where one of them changed; the samples between repeat it.
+struct Row {
+    int64_t frame;
+    int channels;
+    float values[4 + PORT_MAX_CHANNELS];   // VOICE 1-4, then POLY
+
+    int size() const {
+        return 4 + channels;
+    }
+
+    void read(ChordCircle& m, int64_t f) {
+        frame = f;
+        for (int i = 0; i < 4; i++)
+            values[i] = m.outputs[ChordCircle::VOICE_1_OUTPUT + i].getVoltage();
+        Output& poly = m.outputs[ChordCircle::POLY_OUTPUT];
+        channels = poly.getChannels();
+        for (int c = 0; c < channels; c++)
+            values[4 + c] = poly.getVoltage(c);
+    }
+
+    std::string format(bool withFrame) const {
+        std::string s = withFrame ? string::f("%lld %d", (long long)frame, channels) : string::f("%d", channels);
+        for (int i = 0; i < size(); i++)
+            s += string::f(" %.6f", values[i]);
+        return s;
+    }
+
+    bool parse(const char* line) {
+        long long f;
+        int n;
+        if (std::sscanf(line, "%lld %d%n", &f, &channels, &n) != 2 || channels < 1 || channels > PORT_MAX_CHANNELS) return false;
+        frame = f;
+        const char* s = line + n;
+        for (int i = 0; i < size(); i++) {
+            char* end;
+            values[i] = std::strtof(s, &end);
+            if (end == s) return false;
+            s = end;
+        }
+        return true;
+    }
+};
+
+static bool readGolden(const std::string& path, std::vector<Row>& rows) {
+    FILE* file = std::fopen(path.c_str(), "r");
+    if (!file) return false;
+    char line[1024];
+    bool valid = true;
+    while (valid && std::fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') continue;
+        Row row;
+        valid = row.parse(line);
+        rows.push_back(row);
+    }
+    std::fclose(file);
+    return valid && !rows.empty() && rows[0].frame == 0;
+}
+
+static void runScript(const Script& script, const std::string& goldenDir, bool update) {
+    std::string path = goldenDir + "/" + script.name + ".txt";
+    std::vector<Row> golden;
+    if (!update && !CHECK(readGolden(path, golden), "%s: cannot read %s", script.name, path.c_str())) return;
+
+    FILE* out = nullptr;
+    if (update) {
+        out = std::fopen(path.c_str(), "w");
+        if (!CHECK(out, "%s: cannot write %s", script.name, path.c_str())) return;
+        std::fprintf(out, "# Golden outputs of the \"%s\" script in bench/test.cpp, one row per change:\n", script.name);
+        std::fprintf(out, "# sample, POLY channels, VOICE 1-4, POLY. Rewrite with `make test UPDATE_GOLDEN=1`.\n");
+    }
+
+    ChordCircle* m = createModule();
+    script.setup(*m);
+    std::string last;
+    size_t next = 0;
+    for (int64_t frame = 0; frame < script.numSamples; frame++) {
+        script.drive(*m, frame);
+        process(*m, frame);
+        Row row;
+        row.read(*m, frame);
+
+        if (update) {
+            std::string values = row.format(false);
+            if (values != last) std::fprintf(out, "%s\n", row.format(true).c_str());
+            last = values;
+            continue;
+        }
+
+        while (next < golden.size() && golden[next].frame <= frame)
+            next++;
+        const Row& expected = golden[next - 1];
+        bool same = row.channels == expected.channels;
+        for (int i = 0; same && i < row.size(); i++)
+            same = std::fabs(row.values[i] - expected.values[i]) <= GOLDEN_TOLERANCE;
+        if (!CHECK(same, "%s: sample %lld is\n  %s\nexpected\n  %s", script.name, (long long)frame,
+                   row.format(false).c_str(), expected.format(false).c_str()))
+            break;
+    }
+    delete m;
+    if (out) std::fclose(out);
+}
+
+// --- Checks ---
+
+// The chord arithmetic process() ran on every clock edge before the table:
+// voices on scale steps 0, 2, 4 and the quality's step above the degree.
+static float getReferenceVoltage(const ScaleLibrary::Scale& s, int root, int degree, int quality, int voice) {
+    static const int INTERVALS[NUM_QUALITIES] = {6, 0, 5, 8, 10};
+    int interval = (voice < 3) ? voice * 2 : INTERVALS[quality];
+    int scaleIndexRaw = degree + interval;
+    int scaleIndex = scaleIndexRaw % s.size;
+    int octaveShift = scaleIndexRaw / s.size;
+    int notePitchClass = s.notes[scaleIndex];
+    return (root / 12.0f) + (notePitchClass / 12.0f) + (float)octaveShift;
+}
+
+// The name the circle showed before the table: the degree's note and its
+// triad from the third and fifth above it. `fifth` is set to the fifth's
+// interval, which the name leaves out when it is not 6 or 8.
+static std::string getReferenceName(const ScaleLibrary::Scale& s, int rootNote, int degree, int& fifth) {
+    int interval = s.notes[degree % s.size];
+    std::string name = NOTE_NAMES[(rootNote + interval) % 12];
+    int i3 = (s.notes[(degree + 2) % s.size] - interval + 12) % 12;
+    int i5 = (s.notes[(degree + 4) % s.size] - interval + 12) % 12;
+    if (i3 == 3) name += "m";
+    else if (i3 == 2) name += "sus2";
+    else if (i3 == 5) name += "sus4";
+    else if (i3 != 4) name += "?";
+    if (i5 == 6) name += "b5";
+    else if (i5 == 8) name += "#5";
+    fifth = i5;
+    return name;
+}
+
+// Every built-in chord against the arithmetic it replaced, at every root.
+// Names are compared on the octave quality, which is the plain triad, when
+// the old name spelled it fully: the circle now says "dim" for "mb5" and
+// "aug" for "#5". Elsewhere it names notes the old one ignored, the other
+// qualities with their extension, so only the root is compared.
+static void checkChordTable() {
+    const ScaleLibrary* library = ScaleLibrary::current();
+    CHECK(library->size() == 43, "%d built-in scales, expected 43", library->size());
+    for (int sc = 0; sc < library->size(); sc++) {
+        const ScaleLibrary::Scale& s = library->scales[sc];
+        for (int degree = 0; degree < NUM_DEGREES; degree++) {
+            for (int quality = 0; quality < NUM_QUALITIES; quality++) {
+                const ChordEntry& chord = library->getChord(sc, degree, quality);
+                bool same = true;
+                for (int root = 0; root < NUM_ROOTS && same; root++)
+                    for (int k = 0; k < 4 && same; k++)
+                        same = CHECK(std::fabs(library->rootVoltages[root] + chord.voltages[k] - getReferenceVoltage(s, root, degree, quality, k)) < 1e-5f,
+                            "%s degree %d quality %d root %d voice %d: %f, expected %f", s.name, degree, quality, root, k + 1,
+                            library->rootVoltages[root] + chord.voltages[k], getReferenceVoltage(s, root, degree, quality, k));
+
+                for (int root = 0; root < 12; root++) {
+                    int fifth;
+                    std::string expected = getReferenceName(s, root, degree, fifth);
+                    uint16_t set = Quantizer::transpose(chord.mask, root);
+                    std::string name = ChordRecognizer::getName(ChordRecognizer::recognize(set, root + chord.rootOffset));
+                    std::string noteName = NOTE_NAMES[(root + s.notes[degree % s.size]) % 12];
+                    std::string suffix = expected.substr(noteName.size());
+                    if (suffix == "mb5") suffix = "dim";
+                    if (suffix == "#5") suffix = "aug";
+                    bool triad = quality == 1 && ((fifth == 7 && (suffix == "" || suffix == "m" || suffix == "sus2" || suffix == "sus4"))
+                        || suffix == "dim" || suffix == "aug" || suffix == "b5");
+                    bool same = triad ? name == noteName + suffix : name.compare(0, noteName.size(), noteName) == 0
+                        && (name.size() == noteName.size() || name[noteName.size()] != '#');
+                    if (!CHECK(same, "%s degree %d quality %d root %s: named %s, expected %s", s.name, degree, quality,
+                               NOTE_NAMES[root], name.c_str(), triad ? (noteName + suffix).c_str() : expected.c_str()))
+                        return;
+                }
+            }
+        }
+    }
+}
+
+// SPREAD CV opens the voicing at 5V plus the hysteresis going up and closes
+// it at 5V minus the hysteresis going down.
+static void checkSpreadHysteresis() {
+    ChordCircle* m = createModule();
+    connect(m->inputs[ChordCircle::SPREAD_CV_INPUT]);
+    m->setControlDivision(0);
+    float opened = NAN, closed = NAN;
+    int64_t frame = 0;
+    for (int i = 0; i <= 2000; i++, frame++) {
+        float cv = 4.9f + 0.0001f * i;
+        m->inputs[ChordCircle::SPREAD_CV_INPUT].setVoltage(cv);
+        process(*m, frame);
+        if (std::isnan(opened) && m->getSpreadOffset(0) != 0.f) opened = cv;
+    }
+    for (int i = 0; i <= 2000; i++, frame++) {
+        float cv = 5.1f - 0.0001f * i;
+        m->inputs[ChordCircle::SPREAD_CV_INPUT].setVoltage(cv);
+        process(*m, frame);
+        if (std::isnan(closed) && m->getSpreadOffset(0) == 0.f) closed = cv;
+    }
+    float band = CV_HYSTERESIS / 10.f;
+    CHECK(std::fabs(opened - (5.f + band)) < 0.001f && std::fabs(closed - (5.f - band)) < 0.001f,
+          "SPREAD CV opens at %.4fV and closes at %.4fV, expected %.4fV and %.4fV", opened, closed, 5.f + band, 5.f - band);
+    delete m;
+}
+
+// A randomize trigger rewrites one step per sample and swaps the result in
+// whole after the last one. The same seed gives the same pattern.
+static void checkRandomizer() {
+    const int numSteps = 64;
+    Pattern results[2];
+    for (int run = 0; run < 2; run++) {
+        ChordCircle* m = createModule();
+        m->params[ChordCircle::STEPS_COUNT_PARAM].setValue((float)numSteps);
+        process(*m, 0);
+        Pattern before = *m->pattern;
+        m->params[ChordCircle::RANDOMIZE_BTN_PARAM].setValue(1.f);
+        for (int64_t frame = 1; frame < numSteps; frame++) {
+            process(*m, frame);
+            if (!CHECK(std::equal(before.degrees, before.degrees + MAX_STEPS, m->pattern->degrees) && m->pattern->revision == before.revision,
+                       "randomize: pattern changed at sample %lld, before all %d steps were done", (long long)frame, numSteps))
+                break;
+        }
+        process(*m, numSteps);
+        CHECK(m->pattern->revision == before.revision + 1 && !std::equal(before.degrees, before.degrees + numSteps, m->pattern->degrees),
+              "randomize: pattern not taken over after %d samples", numSteps);
+        CHECK(std::equal(before.degrees + numSteps, before.degrees + MAX_STEPS, m->pattern->degrees + numSteps),
+              "randomize: steps past the sequence length changed");
+        // The knobs pick the new degrees up on the next control tick
+        for (int64_t frame = numSteps + 1; frame <= numSteps + CONTROL_DIVISIONS[m->controlDivisionIndex]; frame++)
+            process(*m, frame);
+        for (int i = 0; i < PAGE_SIZE; i++)
+            if (!CHECK(m->params[ChordCircle::STEP_DEGREE_PARAM_0 + i].getValue() == m->pattern->degrees[i],
+                       "randomize: knob %d does not show the new step %d", i + 1, i + 1))
+                break;
+        results[run] = *m->pattern;
+        delete m;
+    }
+    CHECK(std::equal(results[0].degrees, results[0].degrees + MAX_STEPS, results[1].degrees)
+          && std::equal(results[0].qualities, results[0].qualities + MAX_STEPS, results[1].qualities),
+          "randomize: two runs from the same seed differ");
+}
+
+// The step knobs edit one 16-step page, kept within the sequence length;
+// with followPage it tracks the playhead and the knobs show that page. The
+// sequence plays and wraps over all of its steps.
+static void checkPaging() {
+    ChordCircle* m = createModule();
+    m->setControlDivision(0);
+    connect(m->inputs[ChordCircle::CLOCK_INPUT]);
+    m->params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    m->params[ChordCircle::STEPS_COUNT_PARAM].setValue(40.f);
+    m->page = 2;
+    int64_t frame = 0;
+    process(*m, frame++);
+    m->params[ChordCircle::STEP_DEGREE_PARAM_0 + 3].setValue(6.f);
+    process(*m, frame++);
+    CHECK(m->knobPage == 2 && m->pattern->degrees[35] == 6 && m->pattern->degrees[3] == 3,
+          "paging: knob 4 on page 3 set step 36 to %d and step 4 to %d", m->pattern->degrees[35], m->pattern->degrees[3]);
+
+    // Past the last page of the sequence: the knobs stay on the last one
+    m->page = 9;
+    process(*m, frame++);
+    CHECK(m->knobPage == 2, "paging: page 10 of a 40-step sequence shows page %d, expected 3", m->knobPage + 1);
+
+    // 256 steps, every degree different from its neighbours, page following
+    m->params[ChordCircle::STEPS_COUNT_PARAM].setValue((float)MAX_STEPS);
+    for (int i = 0; i < MAX_STEPS; i++)
+        m->pattern->degrees[i] = (uint8_t)((i * 3 + i / 16) % NUM_DEGREES);
+    m->pattern->revision++;
+    m->knobsDirty = true;
+    m->followPage = true;
+    bool ok = true;
+    for (int edge = 0; edge < MAX_STEPS + 2 && ok; edge++) {
+        runClock(*m, frame, frame + 100, 100);
+        int step = m->laneSteps[0];
+        float expected[4];
+        getChord(*m, *m->pattern, step, expected);
+        ok = CHECK(step == (edge + 1) % MAX_STEPS, "paging: edge %d played step %d", edge + 1, step + 1)
+            && CHECK(isPlaying(*m, expected), "paging: step %d does not play its chord", step + 1)
+            && CHECK(m->knobPage == step / PAGE_SIZE, "paging: step %d shown on page %d", step + 1, m->knobPage + 1);
+        for (int i = 0; i < PAGE_SIZE && ok; i++)
+            ok = CHECK(m->params[ChordCircle::STEP_DEGREE_PARAM_0 + i].getValue() == m->pattern->degrees[m->knobPage * PAGE_SIZE + i],
+                       "paging: knob %d does not show step %d", i + 1, m->knobPage * PAGE_SIZE + i + 1);
+    }
+    delete m;
+}
+
+// Every pattern of the bank survives a save and load at its full length,
+// along with the page; patterns from before long sequences still load.
+static void checkPatternSaveLoad() {
+    ChordCircle* saved = createModule();
+    for (int p = 0; p < NUM_PATTERNS; p += 9) {
+        for (int i = 0; i < MAX_STEPS; i++) {
+            saved->patterns[p].degrees[i] = (uint8_t)((i * 5 + p) % NUM_DEGREES);
+            saved->patterns[p].qualities[i] = (uint8_t)((i / 3 + p) % NUM_QUALITIES);
+        }
+    }
+    saved->patterns[1].degrees[199] = 2;   // Only step 200 edited
+    saved->page = 11;
+    saved->followPage = true;
+    saved->selectPattern(9);
+
+    json_t* rootJ = saved->dataToJson();
+    ChordCircle* loaded = createModule();
+    loaded->params[ChordCircle::STEPS_COUNT_PARAM].setValue((float)MAX_STEPS);
+    loaded->dataFromJson(rootJ);
+    json_decref(rootJ);
+
+    for (int p = 0; p < NUM_PATTERNS; p++) {
+        bool same = std::equal(saved->patterns[p].degrees, saved->patterns[p].degrees + MAX_STEPS, loaded->patterns[p].degrees)
+            && std::equal(saved->patterns[p].qualities, saved->patterns[p].qualities + MAX_STEPS, loaded->patterns[p].qualities);
+        CHECK(same, "save/load: pattern %d differs after loading", p + 1);
+    }
+    CHECK(saved->patterns[1].toString().size() == 2 * 200, "save/load: pattern 2 saved as %d characters, expected 400 (up to step 200)",
+          (int)saved->patterns[1].toString().size());
+    CHECK(loaded->getPatternIndex() == 9 && loaded->page == 11 && loaded->followPage,
+          "save/load: pattern %d, page %d, follow %d", loaded->getPatternIndex(), loaded->page, loaded->followPage);
+
+    // A patch from before long sequences: 16 steps per pattern, no page
+    rootJ = json_object();
+    json_t* patternsJ = json_array();
+    json_array_append_new(patternsJ, json_string("60514233241506615243342516061524"));
+    json_object_set_new(rootJ, "patterns", patternsJ);
+    loaded->dataFromJson(rootJ);
+    json_decref(rootJ);
+    Pattern expected;
+    expected.init();
+    CHECK(loaded->patterns[0].degrees[0] == 6 && loaded->patterns[0].qualities[15] == 4 && loaded->page == 0
+          && std::equal(expected.degrees + PAGE_SIZE, expected.degrees + MAX_STEPS, loaded->patterns[0].degrees + PAGE_SIZE),
+          "save/load: a 16-step pattern did not load into steps 1-16 with defaults after");
+    delete saved;
+    delete loaded;
+}
+
+// Chords are prepared ahead of each lane's edge. Whatever changed before the
+// edge, each lane must land on what computing the step and chord on the
+// edge itself gives, and hold it until its next edge.
+static void checkPreparedLanes() {
+    const int NUM_TEST_LANES = 3;
+    const int periods[NUM_TEST_LANES] = {90, 140, 230};
+    ChordCircle* m = createModule();
+    connect(m->inputs[ChordCircle::CLOCK_INPUT], NUM_TEST_LANES);
+    connect(m->outputs[ChordCircle::LANE_VOICE_1_OUTPUT]);
+    int steps[NUM_TEST_LANES] = {};
+    float held[NUM_TEST_LANES][4] = {};
+    bool ok = true;
+    for (int64_t frame = 0; frame < 60000 && ok; frame++) {
+        // Every 14 lane-1 periods, on one of its edges: a new scale, root,
+        // length and step degree at once
+        if (frame % 1260 == 45) {
+            int k = (int)(frame / 1260);
+            m->params[ChordCircle::SCALE_TYPE_PARAM].setValue((float)(k * 7 % m->library->size()));
+            m->params[ChordCircle::ROOT_NOTE_PARAM].setValue((float)(k * 13 % NUM_ROOTS));
+            m->params[ChordCircle::STEPS_COUNT_PARAM].setValue((float)(1 + k * 5 % 20));
+            m->params[ChordCircle::STEP_DEGREE_PARAM_0 + k % PAGE_SIZE].setValue((float)(k % NUM_DEGREES));
+        }
+        for (int c = 0; c < NUM_TEST_LANES; c++)
+            m->inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, periods[c]), c);
+        process(*m, frame);
+
+        for (int c = 0; c < NUM_TEST_LANES && ok; c++) {
+            if (frame % periods[c] == periods[c] / 2) {
+                int numSteps = (int)m->params[ChordCircle::STEPS_COUNT_PARAM].getValue();
+                steps[c] = (steps[c] + 1 < numSteps) ? steps[c] + 1 : 0;
+                getChord(*m, *m->pattern, steps[c], held[c]);
+            }
+            for (int k = 0; k < 4 && ok; k++) {
+                float v = m->outputs[ChordCircle::LANE_VOICE_1_OUTPUT + k].getVoltage(c);
+                ok = CHECK(m->laneSteps[c] == steps[c] && std::fabs(v - held[c][k]) <= 1e-5f,
+                           "lanes: lane %d at sample %lld plays step %d voice %d at %.4fV, expected step %d at %.4fV",
+                           c + 1, (long long)frame, m->laneSteps[c] + 1, k + 1, v, steps[c] + 1, held[c][k]);
+            }
+        }
+    }
+    delete m;
+}
+
+// The module on the right reads a clock edge's chord from the sample after
+// the edge, whichever order the two run in, and the counter only moves with
+// the message: not between edges, nor on an edge that plays the same step
+// again.
+static void checkChordBus() {
+    const int PERIOD = 600;
+    ChordCircle* m = createModule();
+    connect(m->inputs[ChordCircle::CLOCK_INPUT]);
+    m->params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    m->params[ChordCircle::STEPS_COUNT_PARAM].setValue(4.f);
+    const ChordBus::Message* read = (const ChordBus::Message*) m->rightExpander.consumerMessage;
+    uint32_t counter = read->counter;
+    bool ok = CHECK(ChordBus::isValid(read), "chord bus: no valid message before the first clock");
+    for (int64_t frame = 0; frame < 12 * PERIOD && ok; frame++) {
+        // One step from the fifth edge on: every edge plays step 1 again
+        if (frame == 4 * PERIOD + PERIOD / 4) m->params[ChordCircle::STEPS_COUNT_PARAM].setValue(1.f);
+        bool edge = frame % PERIOD == PERIOD / 2;
+        ChordBus::Message before = *(const ChordBus::Message*) m->rightExpander.consumerMessage;
+        m->inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, PERIOD));
+        process(*m, frame);
+        // A neighbour running after this module in the same sample
+        read = (const ChordBus::Message*) m->rightExpander.consumerMessage;
+        ok = CHECK(std::memcmp(read, &before, sizeof(before)) == 0, "chord bus: the message changed within sample %lld", (long long)frame);
+        flipMessages(*m);
+
+        read = (const ChordBus::Message*) m->rightExpander.consumerMessage;
+        bool moved = std::memcmp(read, &before, sizeof(before)) != 0;
+        bool stepMoved = read->step != before.step;
+        ok = ok && CHECK(moved == (edge && stepMoved), "chord bus: message %s at sample %lld", moved ? "rewritten" : "unchanged", (long long)frame)
+            && CHECK(read->counter == counter + moved, "chord bus: counter %u after sample %lld, expected %u",
+                     read->counter, (long long)frame, counter + moved);
+        counter = read->counter;
+        if (!edge || !ok) continue;
+
+        const Pattern& p = *m->pattern;
+        ok = CHECK(read->step == m->laneSteps[0] && read->degree == p.degrees[read->step] && read->quality == p.qualities[read->step]
+                   && read->root == (int)m->params[ChordCircle::ROOT_NOTE_PARAM].getValue() && read->scale == 3, "chord bus: the message after edge %lld does not hold step %d",
+                   (long long)(frame / PERIOD + 1), m->laneSteps[0] + 1);
+        for (int k = 0; k < 4 && ok; k++)
+            ok = CHECK(read->voltages[k] == m->outputs[ChordCircle::VOICE_1_OUTPUT + k].getVoltage(),
+                       "chord bus: voice %d of the message is not VOICE %d", k + 1, k + 1);
+    }
+    CHECK(m->laneSteps[0] == 0 && counter == 4, "chord bus: counter %u after 4 new steps and 8 repeated ones", counter);
+    delete m;
+}
+
+// Control ticks between edges leave LANE VOICE alone, but still catch up
+// with SPREAD and with a cable patched again after edges it missed.
+static void checkLaneOutputs() {
+    const int PERIOD = 1000;
+    ChordCircle* m = createModule();
+    connect(m->inputs[ChordCircle::CLOCK_INPUT]);
+    Output& lane = m->outputs[ChordCircle::LANE_VOICE_1_OUTPUT];
+    int64_t frame = 0;
+    runClock(*m, frame, 2 * PERIOD, PERIOD);
+    // Unpatched for three edges, then patched again between edges, as Rack
+    // does it: one channel, still holding the last voltage written
+    lane.channels = 0;
+    runClock(*m, frame, 5 * PERIOD, PERIOD);
+    lane.channels = 1;
+    runClock(*m, frame, 5 * PERIOD + 16, PERIOD);
+    float chord[4];
+    getChord(*m, *m->pattern, m->laneSteps[0], chord);
+    CHECK(lane.getVoltage() == chord[0], "lane outputs: %.4fV one tick after patching, expected %.4fV", lane.getVoltage(), chord[0]);
+
+    m->params[ChordCircle::SPREAD_PARAM].setValue(1.f);
+    runClock(*m, frame, 5 * PERIOD + 32, PERIOD);
+    CHECK(lane.getVoltage() == chord[0] - 1.f, "lane outputs: %.4fV one tick after opening SPREAD, expected %.4fV", lane.getVoltage(), chord[0] - 1.f);
+    delete m;
+}
+
+// A clock edge only copies the chord prepared for it: with the scale and
+// the step qualities changed between edges, every edge through every scale
+// and quality plays what was prepared before it and computes no chord before
+// its outputs, then prepares the same number for the next. A key changed on
+// the edge itself costs one chord before the outputs per lane stepping, and
+// the rest afterwards, for the lanes patched only.
+static void checkEdgeChords() {
+    ChordCircle* m = createModule();
+    connect(m->inputs[ChordCircle::CLOCK_INPUT]);
+    m->statsEnabled = true;
+    m->voiceLeading = true;
+    const ProcessStats& stats = m->stats;
+    const int PERIOD = 200;
+    int numScales = m->library->size();
+    int64_t frame = 0;
+    bool ok = true;
+    for (int edge = 0; edge < numScales * NUM_QUALITIES && ok; edge++) {
+        m->params[ChordCircle::SCALE_TYPE_PARAM].setValue((float)(edge % numScales));
+        for (int i = 0; i < MAX_STEPS; i++)
+            m->pattern->qualities[i] = (uint8_t)((edge / numScales + i) % NUM_QUALITIES);
+        m->pattern->revision++;
+        runClock(*m, frame, PERIOD / 2 + edge * PERIOD, PERIOD);
+
+        float prepared[4];
+        for (int k = 0; k < 4; k++)
+            prepared[k] = m->nextVoices[k][0];
+        uint64_t chords = stats.chords;
+        runClock(*m, frame, frame + 1, PERIOD);
+        ok = CHECK(stats.clockEdges == (uint64_t)edge + 1 && isPlaying(*m, prepared),
+                   "edge chords: edge %d does not play the chord prepared for it", edge + 1)
+            && CHECK(stats.edgeChords == 0, "edge chords: edge %d in scale %d computed %llu chords before its outputs",
+                     edge + 1, edge % numScales + 1, (unsigned long long)stats.edgeChords.load())
+            && CHECK(stats.chords - chords == 2, "edge chords: edge %d prepared %llu chords, expected 2 (next and reset)",
+                     edge + 1, (unsigned long long)(stats.chords - chords));
+    }
+
+    // Three lanes patched, only lane 1 clocked, the root changed on its
+    // edge; in root position, to compare with the table
+    connect(m->inputs[ChordCircle::CLOCK_INPUT], 3);
+    m->voiceLeading = false;
+    runClock(*m, frame, frame + PERIOD - 1, PERIOD);
+    m->params[ChordCircle::ROOT_NOTE_PARAM].setValue(31.f);
+    uint64_t chords = stats.chords;
+    runClock(*m, frame, frame + 1, PERIOD);
+    float expected[4];
+    getChord(*m, *m->pattern, m->laneSteps[0], expected);
+    CHECK(isPlaying(*m, expected), "edge chords: lane 1 does not play the new root on the edge");
+    CHECK(stats.edgeChords == 1 && stats.chords - chords == 1 + 2 * 3,
+          "edge chords: a root change on an edge computed %llu chords before the outputs and %llu in all, expected 1 and 7",
+          (unsigned long long)stats.edgeChords.load(), (unsigned long long)(stats.chords - chords));
+    delete m;
+}
+
+// The least total movement over every assignment of tones to voices and
+// every octave of each tone, found by enumerating them. With keepBass,
+// voice 0 holds the root where the chord has it.
+static float getLeastMovement(const float prev[4], const float chord[4], bool keepBass) {
+    int tones[4] = {0, 1, 2, 3};
+    float least = INFINITY;
+    do {
+        if (keepBass && tones[0] != 0) continue;
+        float cost = 0.f;
+        for (int i = 0; i < 4; i++) {
+            float nearest = INFINITY;
+            for (int octave = -12; octave <= 12; octave++) {
+                if (keepBass && i == 0 && octave != 0) continue;
+                nearest = std::min(nearest, std::fabs(chord[tones[i]] + octave - prev[i]));
+            }
+            cost += nearest;
+        }
+        least = std::min(least, cost);
+    } while (std::next_permutation(tones, tones + 4));
+    return least;
+}
+
+// The assignment moves the voices no more than any other would. The lead
+// built on it plays every chord tone once, keeps the bass when asked, and
+// keeps each voice and their average in range however long it runs.
+static void checkVoiceLeading() {
+    ChordCircle* m = createModule();
+    const ScaleLibrary& library = *m->library;
+    uint32_t seed = 12345;
+    for (int run = 0; run < 2; run++) {
+        bool keepBass = run == 1;
+        float prev[4] = {0.f, 0.25f, 0.5833f, 0.8333f};
+        bool ok = true;
+        for (int n = 0; n < 5000 && ok; n++) {
+            seed = seed * 1664525u + 1013904223u;
+            int scale = (seed >> 8) % library.size();
+            int degree = (seed >> 16) % NUM_DEGREES;
+            int quality = (seed >> 20) % NUM_QUALITIES;
+            int root = (seed >> 24) % NUM_ROOTS;
+            float chord[4];
+            for (int k = 0; k < 4; k++)
+                chord[k] = library.rootVoltages[root] + library.getChord(scale, degree, quality).voltages[k];
+
+            float assigned[4];
+            float cost = VoiceLeading::assign(prev, chord, keepBass, assigned);
+            float least = getLeastMovement(prev, chord, keepBass);
+            ok = CHECK(std::fabs(cost - least) < 1e-4f, "voice leading: lead %d moves %.4f octaves, the least is %.4f", n, cost, least);
+
+            float out[4];
+            VoiceLeading::lead(prev, chord, keepBass, out);
+            bool used[4] = {};
+            for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 4; j++) {
+                    float octaves = out[i] - chord[j];
+                    if (!used[j] && std::fabs(octaves - std::round(octaves)) < 1e-4f) {
+                        used[j] = true;
+                        break;
+                    }
+                }
+            }
+            float low = *std::min_element(chord, chord + 4) - VoiceLeading::MAX_VOICE_DRIFT;
+            float high = *std::max_element(chord, chord + 4) + VoiceLeading::MAX_VOICE_DRIFT;
+            float drift = 0.f;
+            bool inRange = true;
+            for (int i = keepBass ? 1 : 0; i < 4; i++) {
+                drift += out[i] - chord[i];
+                inRange = inRange && out[i] >= low - 1e-4f && out[i] <= high + 1e-4f;
+            }
+            drift /= keepBass ? 3 : 4;
+            ok = ok && CHECK(used[0] && used[1] && used[2] && used[3], "voice leading: lead %d does not play every chord tone", n)
+                && CHECK(!keepBass || out[0] == chord[0], "voice leading: lead %d moved the bass to %.4fV from %.4fV", n, out[0], chord[0])
+                && CHECK(inRange, "voice leading: lead %d left a voice more than %.1f octaves outside the chord", n, VoiceLeading::MAX_VOICE_DRIFT)
+                && CHECK(std::fabs(drift) <= VoiceLeading::MAX_DRIFT + 1e-4f, "voice leading: lead %d drifted %.4f octaves", n, drift);
+            std::copy(out, out + 4, prev);
+        }
+    }
+    delete m;
+}
+
+static uint64_t getTotal(const std::atomic<uint64_t>* histogram) {
+    uint64_t total = 0;
+    for (int b = 0; b < ProcessStats::NUM_BUCKETS; b++)
+        total += histogram[b].load();
+    return total;
+}
+
+// Every script plays the same with the counters on as off, on every output
+// and channel. Off they stay at zero; on they count each edge and sample.
+static void checkStats() {
+    for (const Script& script : SCRIPTS) {
+        ChordCircle* off = createModule();
+        ChordCircle* on = createModule();
+        on->statsEnabled = true;
+        script.setup(*off);
+        script.setup(*on);
+        bool same = true;
+        for (int64_t frame = 0; frame < script.numSamples && same; frame++) {
+            script.drive(*off, frame);
+            script.drive(*on, frame);
+            process(*off, frame);
+            process(*on, frame);
+            for (int o = 0; o < ChordCircle::OUTPUTS_LEN && same; o++)
+                same = std::equal(off->outputs[o].voltages, off->outputs[o].voltages + PORT_MAX_CHANNELS, on->outputs[o].voltages)
+                    && off->outputs[o].channels == on->outputs[o].channels;
+            same = CHECK(same, "stats: %s differs with counters on at sample %lld", script.name, (long long)frame);
+        }
+        const ProcessStats& s = off->stats;
+        CHECK(s.clockEdges == 0 && s.resets == 0 && s.randomizations == 0 && s.worstTriggerNs == 0
+              && getTotal(s.triggerHistogram) == 0 && getTotal(s.sampleHistogram) == 0,
+              "stats: %s counted with the counters off", script.name);
+        uint64_t numSamples = getTotal(on->stats.triggerHistogram) + getTotal(on->stats.sampleHistogram);
+        CHECK(numSamples == (uint64_t)script.numSamples, "stats: %s timed %llu of %lld samples",
+              script.name, (unsigned long long)numSamples, (long long)script.numSamples);
+        if (script.setup == setupSequence) {
+            // A clock of 960 samples, rising at 480 + 960 k
+            uint64_t edges = on->stats.clockEdges;
+            CHECK(edges == 25 && getTotal(on->stats.triggerHistogram) == 25, "stats: %s counted %llu edges, expected 25",
+                  script.name, (unsigned long long)edges);
+        }
+        delete off;
+        delete on;
+    }
+}
+
+// The step of `tuning` nearest to `volts`, by trying every step in range;
+// ties go down
+static int getReferenceStep(const Tuning& tuning, float volts) {
+    int best = 0;
+    for (int step = -4 * tuning.size(); step <= 8 * tuning.size(); step++)
+        if (std::fabs(tuning.getVoltage(step) - volts) < std::fabs(tuning.getVoltage(best) - volts)) best = step;
+    return best;
+}
+
+static bool isOnStep(const Tuning& tuning, float volts) {
+    int step = getReferenceStep(tuning, volts);
+    return std::fabs(tuning.getVoltage(step) - volts) < 1e-5f;
+}
+
+// A library mapped onto `tuning`: every scale note is the tuning's nearest
+// step to the 12-TET note, and every root and chord voltage is on a step.
+static void checkTunedLibrary(const Tuning& tuning) {
+    const ScaleLibrary* base = ScaleLibrary::current();
+    const ScaleLibrary* library = ScaleLibrary::buildTuned(tuning);
+    const char* name = tuning.name.c_str();
+    bool ok = true;
+    for (int sc = 0; sc < base->size() && ok; sc++) {
+        const ScaleLibrary::Scale& from = base->scales[sc];
+        const ScaleLibrary::Scale& to = library->scales[sc];
+        int size = 0;
+        for (int i = 0; i < from.size; i++) {
+            int note = eucMod(getReferenceStep(tuning, from.notes[i] / 12.f * tuning.period), tuning.size());
+            if (size == 0 || note > to.notes[size - 1]) {
+                ok = ok && CHECK(size < to.size && to.notes[size] == note, "%s: %s note %d maps to step %d, expected %d",
+                                 name, from.name, i + 1, size < to.size ? to.notes[size] : -1, note);
+                size++;
+            }
+        }
+        ok = ok && CHECK(size == to.size, "%s: %s has %d notes, expected %d", name, from.name, to.size, size);
+        for (int degree = 0; degree < NUM_DEGREES && ok; degree++)
+            for (int quality = 0; quality < NUM_QUALITIES && ok; quality++)
+                for (int k = 0; k < 4 && ok; k++)
+                    ok = CHECK(isOnStep(tuning, library->getChord(sc, degree, quality).voltages[k]),
+                               "%s: %s degree %d quality %d voice %d is off the tuning", name, from.name, degree + 1, quality, k + 1);
+    }
+    for (int r = 0; r < NUM_ROOTS && ok; r++) {
+        float expected = tuning.getVoltage(getReferenceStep(tuning, r / 12.f));
+        ok = CHECK(std::fabs(library->rootVoltages[r] - expected) < 1e-5f, "%s: root %d at %.5fV, expected %.5fV",
+                   name, r, library->rootVoltages[r], expected);
+    }
+    // The whole tuning as a scale of its own, after the mapped ones
+    if (tuning.size() != 12 && tuning.size() <= MAX_SCALE_NOTES) {
+        const ScaleLibrary::Scale& all = library->scales.back();
+        CHECK(library->size() == base->size() + 1 && all.size == tuning.size() && tuning.name == all.name,
+              "%s: the tuning is not added as a scale", name);
+    }
+    ScaleLibrary::retire(library);
+}
+
+// 19-EDO and two Scala files, one with a step in cents and one repeating at
+// 3/1, mapped onto the scales; then 19-EDO played
+static void checkTunings() {
+    Tuning edo;
+    edo.setEdo(19);
+    checkTunedLibrary(edo);
+
+    const char* path = "bench/build/test.scl";
+    FILE* file = std::fopen(path, "w");
+    std::fputs("! test.scl\nJust pentatonic\n 5\n!\n 9/8\n 5/4\n 3/2\n 884.359\n 2/1\n", file);
+    std::fclose(file);
+    Tuning just;
+    std::string error;
+    CHECK(just.loadScala(path, error) && just.size() == 5 && just.name == "Just pentatonic", "Scala: %s", error.c_str());
+    CHECK(std::fabs(just.steps[2] - std::log2(1.25f)) < 1e-6f && std::fabs(just.steps[4] - 0.73697f) < 1e-5f,
+          "Scala: ratio and cents steps parsed as %.5f and %.5f", just.steps[2], just.steps[4]);
+    checkTunedLibrary(just);
+
+    file = std::fopen(path, "w");
+    std::fputs("Bohlen-Pierce\n 13\n 27/25\n 25/21\n 9/7\n 7/5\n 75/49\n 5/3\n 9/5\n 49/25\n 15/7\n 7/3\n 63/25\n 25/9\n 3/1\n", file);
+    std::fclose(file);
+    Tuning tritave;
+    CHECK(tritave.loadScala(path, error) && tritave.size() == 13 && std::fabs(tritave.period - std::log2(3.f)) < 1e-6f,
+          "Scala: Bohlen-Pierce loaded with %d steps and a period of %.4fV", tritave.size(), tritave.period);
+    for (float volts = -2.f; volts < 4.f; volts += 0.0137f)
+        if (!CHECK(tritave.getNearestStep(volts) == getReferenceStep(tritave, volts), "Bohlen-Pierce: %.4fV maps to step %d, expected %d",
+                   volts, tritave.getNearestStep(volts), getReferenceStep(tritave, volts)))
+            break;
+    checkTunedLibrary(tritave);
+    std::remove(path);
+
+    // A4 at 432 Hz moves 12-EDO down by a few cents; the same mapping two
+    // octaves up is refused, as a patch saved with it loads without it
+    path = "bench/build/test.kbm";
+    const char* mappings[] = {"12\n0\n127\n60\n69\n432.0\n12\n0\n1\n2\n3\n4\n5\n6\n7\n8\n9\n10\n11\n",
+                              "12\n0\n127\n60\n69\n1728.0\n12\n0\n1\n2\n3\n4\n5\n6\n7\n8\n9\n10\n11\n"};
+    Tuning mapped;
+    for (int i = 0; i < 2; i++) {
+        file = std::fopen(path, "w");
+        std::fputs(mappings[i], file);
+        std::fclose(file);
+        error.clear();
+        bool loaded = mapped.loadKeyboardMapping(path, error);
+        float expected = std::log2(432.f / 440.f);
+        CHECK(loaded == (i == 0) && std::fabs(mapped.offset - expected) < 1e-5f,
+              "keyboard mapping %d: %s, offset %.5fV, expected %.5fV (%s)", i + 1, loaded ? "loaded" : "refused",
+              mapped.offset, expected, error.c_str());
+    }
+    std::remove(path);
+    json_t* mappedJ = mapped.toJson();
+    json_object_set_new(mappedJ, "offset", json_real(2.0));
+    mapped.fromJson(mappedJ);
+    json_decref(mappedJ);
+    CHECK(mapped.offset == 0.f, "keyboard mapping: a patch with an offset of 2V loads it as %.5fV", mapped.offset);
+
+    // A module in 19-EDO plays only 19-EDO pitches
+    ChordCircle* m = createModule();
+    connect(m->inputs[ChordCircle::CLOCK_INPUT]);
+    m->setTuning(edo);
+    m->params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    int64_t frame = 0;
+    bool ok = true;
+    while (frame < 20000 && ok) {
+        runClock(*m, frame, frame + 1000, 1000);
+        for (int k = 0; k < 4 && ok; k++)
+            ok = CHECK(isOnStep(edo, m->outputs[ChordCircle::VOICE_1_OUTPUT + k].getVoltage()), "19-EDO: voice %d at %.5fV at sample %lld",
+                       k + 1, m->outputs[ChordCircle::VOICE_1_OUTPUT + k].getVoltage(), (long long)frame);
+    }
+    delete m;
+}
+
+// ANALYZE names the poly voltages patched to it, in any octave and order.
+// A bass note that spells a plain chord is its root, otherwise the best
+// fitting root is; notes no shape explains are named as extensions.
+static void checkAnalyze() {
+    struct Case {
+        const char* name;
+        int channels;
+        float voltages[6];
+    };
+    const Case cases[] = {
+        {"C", 3, {0.f, 4 / 12.f, 7 / 12.f}},
+        {"C", 3, {4 / 12.f, 7 / 12.f, 1.f}},                       // First inversion
+        {"G7", 4, {5 / 12.f, 7 / 12.f, 11 / 12.f, 14 / 12.f}},     // Third inversion
+        {"Am7", 4, {-3 / 12.f, 0.f, 4 / 12.f, 7 / 12.f}},          // A in the bass under C
+        {"C", 3, {-2.f, 3 + 4 / 12.f, 1 + 7 / 12.f}},              // Octaves apart
+        {"C", 3, {20.f, 4 / 12.f, 7 / 12.f}},                      // Past Rack's range: C at 12V
+        {"C", 6, {0.f, 4 / 12.f, 7 / 12.f, 1.f, 16 / 12.f, 19 / 12.f}},
+        {"C5", 2, {0.f, 7 / 12.f}},
+        {"C(b9,9)", 3, {0.f, 1 / 12.f, 2 / 12.f}},                 // No shape beyond the root
+        {"C#maj7(b9,9,#9)", 6, {0.f, 1 / 12.f, 2 / 12.f, 3 / 12.f, 4 / 12.f, 5 / 12.f}},
+    };
+    ChordCircle* m = createModule();
+    Input& in = m->inputs[ChordCircle::ANALYZE_INPUT];
+    int64_t frame = 0;
+    for (const Case& c : cases) {
+        connect(in, c.channels);
+        for (int i = 0; i < c.channels; i++)
+            in.setVoltage(c.voltages[i], i);
+        // Analyzed on the control divider
+        for (int64_t end = frame + 16; frame < end; frame++)
+            process(*m, frame);
+        std::string name = ChordRecognizer::getName(m->analyzedChord);
+        CHECK(name == c.name, "analyze: %d voices from %.3fV named \"%s\", expected \"%s\"",
+              c.channels, c.voltages[0], name.c_str(), c.name);
+    }
+    in.channels = 0;
+    for (int64_t end = frame + 16; frame < end; frame++)
+        process(*m, frame);
+    CHECK(!m->analyzedChord.isValid(), "analyze: still naming a chord after ANALYZE was unpatched");
+    delete m;
+}
+
+// Two leaders and a follower on one channel, clocked on the same edges and
+// processed in both orders. The second leader waits while the first holds
+// the channel and takes over once it stops leading; the follower plays the
+// leader's chord on every edge, not one edge late.
+static void checkHarmonyBus() {
+    const int CHANNEL = 2;
+    const int PERIOD = 400;
+    const int NUM_EDGES = 48;
+    ChordCircle* modules[3];
+    for (int i = 0; i < 3; i++) {
+        modules[i] = createModule();
+        connect(modules[i]->inputs[ChordCircle::CLOCK_INPUT]);
+        modules[i]->harmonyChannel = CHANNEL;
+    }
+    ChordCircle& first = *modules[0];
+    ChordCircle& second = *modules[1];
+    ChordCircle& follower = *modules[2];
+    first.harmonyRole = HarmonyBus::ROLE_LEADER;
+    second.harmonyRole = HarmonyBus::ROLE_LEADER;
+    follower.harmonyRole = HarmonyBus::ROLE_FOLLOWER;
+    // Each leader with its own root, scale and chords
+    first.params[ChordCircle::ROOT_NOTE_PARAM].setValue(24.f);
+    first.params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    second.params[ChordCircle::ROOT_NOTE_PARAM].setValue(31.f);
+    second.params[ChordCircle::SCALE_TYPE_PARAM].setValue(5.f);
+    for (int i = 0; i < MAX_STEPS; i++) {
+        first.pattern->degrees[i] = (uint8_t)(i * 3 % NUM_DEGREES);
+        first.pattern->qualities[i] = (uint8_t)(i % NUM_QUALITIES);
+        second.pattern->degrees[i] = (uint8_t)(i * 5 % NUM_DEGREES);
+        second.pattern->qualities[i] = (uint8_t)((i + 1) % NUM_QUALITIES);
+    }
+    first.pattern->revision++;
+    second.pattern->revision++;
+
+    int64_t frame = 0;
+    bool ok = true;
+    for (int edge = 0; edge < NUM_EDGES && ok; edge++) {
+        // Handed over a third of the way in; leading again later, the first
+        // waits for the second
+        if (edge == NUM_EDGES / 3) first.harmonyRole = HarmonyBus::ROLE_OFF;
+        if (edge == 2 * NUM_EDGES / 3) first.harmonyRole = HarmonyBus::ROLE_LEADER;
+        ChordCircle& leader = (edge < NUM_EDGES / 3) ? first : second;
+        for (; frame <= PERIOD / 2 + edge * PERIOD; frame++) {
+            for (int i = 0; i < 3; i++) {
+                ChordCircle& m = *modules[(edge % 2) ? 2 - i : i];
+                m.inputs[ChordCircle::CLOCK_INPUT].setVoltage(getClock(frame, PERIOD));
+                process(m, frame);
+            }
+        }
+        float chord[4];
+        for (int k = 0; k < 4; k++)
+            chord[k] = leader.outputs[ChordCircle::VOICE_1_OUTPUT + k].getVoltage();
+        ok = CHECK(HarmonyBus::channels[CHANNEL].leader.load() == &leader,
+                   "harmony bus: the %s leader does not hold the channel at edge %d", (&leader == &first) ? "first" : "second", edge + 1)
+            && CHECK(isPlaying(follower, chord), "harmony bus: the follower does not play the leader's chord on edge %d", edge + 1);
+    }
+    for (int i = 0; i < 3; i++)
+        delete modules[i];
+    CHECK(!HarmonyBus::hasLeader(CHANNEL), "harmony bus: the channel still has a leader after its modules were removed");
+}
+
+// A library taken out of use is freed once every module has passed a
+// control tick since, and not before: module `a` changes tuning, module `b`
+// only has to tick. A tuned library keeps the reloaded scales it was built
+// from alive.
+static void checkLibraryLifetime() {
+    ScaleLibrary::collect();
+    int live = ScaleLibrary::getNumLive();
+    ChordCircle* a = createModule();
+    ChordCircle* b = createModule();
+    a->setControlDivision(0);
+    b->setControlDivision(0);
+    int64_t frame = 0;
+    Tuning tuning;
+    tuning.setEdo(19);
+    a->setTuning(tuning);
+    process(*a, frame);
+    process(*b, frame++);
+    CHECK(a->library->scales.back().name == std::string("19-EDO"), "libraries: module a did not pick up 19-EDO");
+
+    tuning.setEdo(22);
+    a->setTuning(tuning);
+    ScaleLibrary::collect();
+    CHECK(ScaleLibrary::getNumLive() == live + 2, "libraries: 19-EDO freed before module a moved on (%d live, expected %d)",
+          ScaleLibrary::getNumLive(), live + 2);
+    process(*a, frame);
+    ScaleLibrary::collect();
+    CHECK(ScaleLibrary::getNumLive() == live + 2, "libraries: 19-EDO freed before module b ticked");
+    process(*b, frame++);
+    ScaleLibrary::collect();
+    CHECK(ScaleLibrary::getNumLive() == live + 1, "libraries: %d live after both modules moved on, expected %d",
+          ScaleLibrary::getNumLive(), live + 1);
+
+    // Reloaded scales: the tuning is rebuilt on them, and the scales it was
+    // built from stay until the rebuilt tuning is replaced in turn
+    ScaleLibrary::reload();
+    a->refreshTuning();
+    const ScaleLibrary* reloaded = ScaleLibrary::current();
+    ScaleLibrary::reload();
+    process(*a, frame);
+    process(*b, frame++);
+    ScaleLibrary::collect();
+    CHECK(a->library->base == reloaded && ScaleLibrary::getNumLive() == live + 3,
+          "libraries: %d live with the tuning on replaced scales, expected %d", ScaleLibrary::getNumLive(), live + 3);
+    a->refreshTuning();
+    process(*a, frame);
+    process(*b, frame++);
+    ScaleLibrary::collect();
+    CHECK(a->library->base == ScaleLibrary::current() && ScaleLibrary::getNumLive() == live + 2,
+          "libraries: %d live with the tuning on the latest scales, expected %d", ScaleLibrary::getNumLive(), live + 2);
+
+    // A removed module's tuning goes once the others have ticked
+    delete a;
+    process(*b, frame++);
+    ScaleLibrary::collect();
+    CHECK(ScaleLibrary::getNumLive() == live + 1, "libraries: %d live after removing module a, expected %d",
+          ScaleLibrary::getNumLive(), live + 1);
+    delete b;
+}
+
+// Clocks a tracker at `period` samples for `edges` edges, the first one
+// `period` samples from now. Returns the ticks.
+static int clockTracker(ClockTracker& tracker, uint32_t period, int edges, int multiply = 1, int divide = 1) {
+    const uint32_t maxInterval = (uint32_t)(MAX_CLOCK_SECONDS * SAMPLE_RATE);
+    int ticks = 0;
+    for (int e = 0; e < edges; e++)
+        for (uint32_t i = 1; i <= period; i++)
+            ticks += tracker.process(i == period, multiply, divide, maxInterval, true);
+    return ticks;
+}
+
+static void checkClockTracker() {
+    ClockTracker tracker;
+    clockTracker(tracker, 1000, 10);
+    CHECK(tracker.period == 1000 && tracker.getJitter() == 0, "period %u jitter %u, expected 1000 and 0", tracker.period, tracker.getJitter());
+
+    // Stopped for longer than MAX_CLOCK_SECONDS, then restarted at a new
+    // tempo: the first interval after the gap sets the period on its own
+    const uint32_t maxInterval = (uint32_t)(MAX_CLOCK_SECONDS * SAMPLE_RATE);
+    for (uint32_t i = 0; i < maxInterval + 1000; i++)
+        tracker.process(false, 1, 1, maxInterval, true);
+    tracker.process(true, 1, 1, maxInterval, true);
+    CHECK(tracker.period == 0, "period %u after a stopped clock, expected 0 (unknown)", tracker.period);
+    for (int e = 1; e <= 4; e++) {
+        clockTracker(tracker, 500, 1);
+        CHECK(tracker.period == 500, "period %u after %d edges at 500 following a stop, expected 500", tracker.period, e);
+    }
+
+    // One missed pulse does not move the median
+    clockTracker(tracker, 500, 6);
+    clockTracker(tracker, 1000, 1);
+    CHECK(tracker.period == 500, "period %u after a missed pulse, expected 500", tracker.period);
+
+    // x4: an edge tick plus three at even quarters; /3: every third edge
+    clockTracker(tracker, 400, 8, 4);
+    std::vector<uint32_t> tickTimes;
+    for (uint32_t i = 1; i <= 400; i++)
+        if (tracker.process(i == 400, 4, 1, maxInterval, true)) tickTimes.push_back(i);
+    CHECK(tickTimes.size() == 4 && tickTimes[0] == 100 && tickTimes[1] == 200 && tickTimes[2] == 300 && tickTimes[3] == 400,
+          "x4 ticks at %s, expected 100 200 300 400", tickTimes.size() == 4 ? "other times" : "a different count");
+    tracker.reset();
+    int ticks = clockTracker(tracker, 400, 9, 1, 3);
+    CHECK(ticks == 3, "/3 gave %d ticks on 9 edges, expected 3", ticks);
+}
+
+// Track mode re-voices the step playing now from the active pattern. A
+// requested pattern changes nothing until the edge that switches to it.
+static void checkTrackMode() {
+    ChordCircle* m = createModule();
+    connect(m->inputs[ChordCircle::CLOCK_INPUT]);
+    m->params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    m->trackMode = true;
+    for (int i = 0; i < MAX_STEPS; i++) {
+        m->patterns[1].degrees[i] = (i + 3) % NUM_DEGREES;
+        m->patterns[1].qualities[i] = 1;
+    }
+    m->patterns[1].revision++;
+
+    int64_t frame = 0;
+    runClock(*m, frame, 2700, 1000);
+    float before[4];
+    getChord(*m, m->patterns[0], m->laneSteps[0], before);
+    CHECK(isPlaying(*m, before), "track mode: not playing step %d of pattern 0", m->laneSteps[0]);
+
+    m->requestedPattern = 1;
+    for (; frame < 3000; frame++) {
+        runClock(*m, frame, frame + 1, 1000);
+        if (!CHECK(isPlaying(*m, before), "track mode: outputs moved at sample %lld, before the edge at 3500", (long long)frame))
+            break;
+    }
+
+    // A new root still re-voices the step playing, from pattern 0
+    m->params[ChordCircle::ROOT_NOTE_PARAM].setValue(26.f);
+    runClock(*m, frame, 3400, 1000);
+    float tracked[4];
+    getChord(*m, m->patterns[0], m->laneSteps[0], tracked);
+    CHECK(isPlaying(*m, tracked), "track mode: a root change did not re-voice step %d of pattern 0", m->laneSteps[0]);
+
+    runClock(*m, frame, 3600, 1000);
+    float after[4];
+    getChord(*m, m->patterns[1], m->laneSteps[0], after);
+    CHECK(m->getPatternIndex() == 1 && isPlaying(*m, after), "track mode: not playing step %d of pattern 1 after the edge", m->laneSteps[0]);
+    delete m;
+}
+
+// Track mode under a strum: a key change that leaves the chord alone
+// changes nothing, and a new root moves only the voices already strummed;
+// the others take it on their own note-on.
+static void checkTrackStrum() {
+    const int PERIOD = 4800;
+    const int SPACING = 480;   // 10 ms
+    ChordCircle* m = createModule();
+    connect(m->inputs[ChordCircle::CLOCK_INPUT]);
+    m->params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    m->trackMode = true;
+    m->strumMode = StrumScheduler::MODE_STRUM;
+    m->strumMs = 10.f;
+    int64_t frame = 0;
+    int64_t edge = PERIOD / 2 + PERIOD;
+    runClock(*m, frame, edge + SPACING / 2, PERIOD);
+
+    float held[4];
+    for (int k = 0; k < 4; k++)
+        held[k] = m->outputs[ChordCircle::VOICE_1_OUTPUT + k].getVoltage();
+    m->params[ChordCircle::STEPS_COUNT_PARAM].setValue(5.f);
+    runClock(*m, frame, edge + SPACING, PERIOD);
+    CHECK(isPlaying(*m, held), "track strum: STEPS moved the voices of a strum under way");
+
+    // Voices 1 and 2 strummed by now, 3 and 4 still to come
+    m->params[ChordCircle::ROOT_NOTE_PARAM].setValue(26.f);
+    runClock(*m, frame, edge + 2 * SPACING - 16, PERIOD);
+    float chord[4];
+    getChord(*m, *m->pattern, m->laneSteps[0], chord);
+    for (int k = 0; k < 4; k++) {
+        bool strummed = m->outputs[ChordCircle::GATE_1_OUTPUT + k].getVoltage() > 0.f;
+        float expected = strummed ? chord[k] : held[k];
+        float v = m->outputs[ChordCircle::VOICE_1_OUTPUT + k].getVoltage();
+        CHECK(strummed == (k < 2) && v == expected, "track strum: voice %d at %.4fV before its note-on, expected %.4fV", k + 1, v, expected);
+    }
+    runClock(*m, frame, edge + 4 * SPACING, PERIOD);
+    CHECK(isPlaying(*m, chord), "track strum: the last voices of the strum did not take the new root");
+    delete m;
+}
+
+// Each voice of a new chord starts `spacing` samples after the one before,
+// lowest or highest first, and holds its gate until the next edge; an
+// arpeggio closes each gate half a spacing after it opened. Every gate
+// closes on the edge itself, so the first note retriggers.
+static void checkStrum() {
+    struct Case {
+        const char* name;
+        int mode;
+        int order;
+        bool sync;
+        uint32_t spacing;
+    };
+    const int PERIOD = 4800;
+    const Case cases[] = {
+        {"strum up", StrumScheduler::MODE_STRUM, StrumScheduler::ORDER_UP, false, 96},      // 2 ms
+        {"strum down", StrumScheduler::MODE_STRUM, StrumScheduler::ORDER_DOWN, false, 96},
+        {"arpeggio up", StrumScheduler::MODE_ARPEGGIO, StrumScheduler::ORDER_UP, false, 96},
+        {"arpeggio down at 1/8", StrumScheduler::MODE_ARPEGGIO, StrumScheduler::ORDER_DOWN, true, PERIOD / 8},
+        {"off", StrumScheduler::MODE_OFF, StrumScheduler::ORDER_UP, false, 0},
+    };
+    for (const Case& c : cases) {
+        ChordCircle* m = createModule();
+        connect(m->inputs[ChordCircle::CLOCK_INPUT]);
+        m->params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+        m->strumMode = c.mode;
+        m->strumOrder = c.order;
+        m->strumSync = c.sync;
+        m->strumMs = 2.f;
+        m->strumDivisionIndex = 4;   // 1/8
+        int64_t frame = 0;
+        const int64_t edge = PERIOD / 2 + 2 * PERIOD;
+        runClock(*m, frame, edge, PERIOD);
+        float prev[4];
+        for (int k = 0; k < 4; k++)
+            prev[k] = m->outputs[ChordCircle::VOICE_1_OUTPUT + k].getVoltage();
+
+        float chord[4];
+        int64_t noteOn[4];
+        bool ok = true;
+        for (int64_t t = edge; t < edge + PERIOD && ok; t++) {
+            runClock(*m, frame, t + 1, PERIOD);
+            if (t == edge) {
+                getChord(*m, *m->pattern, m->laneSteps[0], chord);
+                int voices[4] = {0, 1, 2, 3};
+                std::stable_sort(voices, voices + 4, [&](int a, int b) { return chord[a] < chord[b]; });
+                if (c.order == StrumScheduler::ORDER_DOWN) std::reverse(voices, voices + 4);
+                for (int rank = 0; rank < 4; rank++)
+                    noteOn[voices[rank]] = edge + 1 + rank * c.spacing;
+            }
+            for (int k = 0; k < 4 && ok; k++) {
+                bool on = t >= noteOn[k];
+                bool gate = on && (c.mode != StrumScheduler::MODE_ARPEGGIO || t < noteOn[k] + c.spacing / 2);
+                // Unstrummed voices move on the edge; only their gates wait a sample
+                float expected = (on || (c.mode == StrumScheduler::MODE_OFF)) ? chord[k] : prev[k];
+                float voltage = m->outputs[ChordCircle::VOICE_1_OUTPUT + k].getVoltage();
+                float gateVoltage = m->outputs[ChordCircle::GATE_1_OUTPUT + k].getVoltage();
+                ok = CHECK(std::fabs(voltage - expected) < 1e-5f && gateVoltage == (gate ? 10.f : 0.f),
+                           "%s: voice %d at %lld samples after the edge is %.4fV, gate %.0fV; expected %.4fV, gate %dV",
+                           c.name, k + 1, (long long)(t - edge), voltage, gateVoltage, expected, gate ? 10 : 0);
+            }
+        }
+        delete m;
+    }
+}
+
+// The note of `mask` nearest to `volts` rounded to a semitone, by trying
+// every note an octave either side; ties go down. Without notes, the semitone.
+static float getReferenceSnap(uint16_t mask, float volts) {
+    int note = (int)std::round(clamp(volts, -12.f, 12.f) * 12.f);
+    int best = note;
+    for (int n = note - 12; n <= note + 12 && mask; n++)
+        if ((mask & (1 << eucMod(n, 12))) && (!(mask & (1 << eucMod(best, 12))) || std::abs(n - note) < std::abs(best - note)))
+            best = n;
+    return best / 12.f;
+}
+
+// QNT snaps each of 16 channels to the chord playing, from the edge that
+// plays it, or to the scale on the root; unpatched it falls silent.
+static void checkQuantizer() {
+    Quantizer quantizer;
+    uint32_t seed = 777;
+    bool ok = true;
+    for (int n = 0; n < 20000 && ok; n++) {
+        seed = seed * 1664525u + 1013904223u;
+        quantizer.setMask(seed >> 20);
+        float volts = ((int32_t)seed / 2147483648.f) * 14.f;
+        float_4 out = quantizer.process(float_4(volts));
+        float expected = getReferenceSnap(quantizer.mask, volts);
+        ok = CHECK(std::fabs(out[0] - expected) < 1e-5f, "quantizer: %.4fV snapped to %.4fV with mask %03x, expected %.4fV",
+                   volts, out[0], quantizer.mask, expected);
+    }
+
+    for (int mode = 0; mode < ChordCircle::NUM_QUANTIZE_MODES; mode++) {
+        const char* name = (mode == ChordCircle::QUANTIZE_SCALE) ? "scale" : "chord";
+        ChordCircle* m = createModule();
+        connect(m->inputs[ChordCircle::CLOCK_INPUT]);
+        connect(m->inputs[ChordCircle::QUANTIZE_INPUT], PORT_MAX_CHANNELS);
+        m->params[ChordCircle::SCALE_TYPE_PARAM].setValue(5.f);
+        m->params[ChordCircle::ROOT_NOTE_PARAM].setValue(27.f);
+        m->quantizeMode = mode;
+        const ScaleLibrary::Scale& scale = m->library->scales[5];
+        Input& in = m->inputs[ChordCircle::QUANTIZE_INPUT];
+        Output& out = m->outputs[ChordCircle::QUANTIZE_OUTPUT];
+        ok = true;
+        for (int64_t frame = 0; frame < 8000 && ok; ) {
+            for (int c = 0; c < PORT_MAX_CHANNELS; c++)
+                in.voltages[c] = -13.f + 26.f * ((frame * 7 + c * 131) % 997) / 997.f;
+            runClock(*m, frame, frame + 1, 500);
+            uint16_t mask = 0;
+            if (mode == ChordCircle::QUANTIZE_SCALE) {
+                for (int i = 0; i < scale.size; i++)
+                    mask |= 1 << (27 + scale.notes[i]) % 12;
+            }
+            else {
+                float chord[4];
+                getChord(*m, *m->pattern, m->laneSteps[0], chord);
+                for (int k = 0; k < 4; k++)
+                    mask |= 1 << eucMod((int)std::round(chord[k] * 12.f), 12);
+            }
+            // From the first edge: nothing plays before it, and the knobs
+            // set above are read on a control tick
+            bool playing = frame > 250;
+            ok = CHECK(out.getChannels() == PORT_MAX_CHANNELS, "quantizer %s: %d channels out", name, out.getChannels());
+            for (int c = 0; c < PORT_MAX_CHANNELS && ok && playing; c++)
+                ok = CHECK(std::fabs(out.getVoltage(c) - getReferenceSnap(mask, in.voltages[c])) < 1e-5f,
+                           "quantizer %s: channel %d at sample %lld snapped %.4fV to %.4fV, expected %.4fV", name, c + 1,
+                           (long long)frame - 1, in.voltages[c], out.getVoltage(c), getReferenceSnap(mask, in.voltages[c]));
+        }
+
+        connect(in, 0);
+        process(*m, 8000);
+        CHECK(out.getChannels() == 1 && out.getVoltage(0) == 0.f && out.voltages[1] == 0.f,
+              "quantizer %s: unpatched input left %d channels at %.4fV", name, out.getChannels(), out.getVoltage(0));
+        delete m;
+    }
+}
+
+// POLY carries numVoices channels: the chord, then stacked thirds (9th,
+// 11th, 13th) or octaves of the voices below, each an octave above the one
+// 7 or 4 channels down. A drop voicing lowers the 2nd or 3rd highest of
+// them by a period; VOICE 1-4 keep the chord.
+static void checkVoicing() {
+    ChordCircle* m = createModule();
+    connect(m->inputs[ChordCircle::CLOCK_INPUT]);
+    m->params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    m->params[ChordCircle::STEPS_COUNT_PARAM].setValue(7.f);
+    const ScaleLibrary& library = *m->library;
+    int64_t frame = 0;
+    bool ok = true;
+    for (int numVoices = 1; numVoices <= Voicing::MAX_VOICES && ok; numVoices++) {
+        for (int extension = 0; extension < Voicing::NUM_EXTENSIONS && ok; extension++) {
+            for (int drop = 0; drop < Voicing::NUM_DROPS && ok; drop++) {
+                m->numVoices = numVoices;
+                m->voicingExtension = extension;
+                m->voicingDrop = drop;
+                runClock(*m, frame, frame + 1000, 1000);
+
+                int step = m->laneSteps[0];
+                int degree = m->pattern->degrees[step];
+                float root = library.rootVoltages[(int)m->params[ChordCircle::ROOT_NOTE_PARAM].getValue()];
+                const ScaleLibrary::Scale& scale = library.scales[3];
+                float expected[Voicing::MAX_VOICES];
+                getChord(*m, *m->pattern, step, expected);
+                for (int k = 4; k < numVoices; k++) {
+                    int index = degree + 2 * k;
+                    if (extension == Voicing::EXTEND_OCTAVES) expected[k] = expected[k - 4] + 1.f;
+                    else if (k < 7) expected[k] = root + scale.voltages[index % scale.size] + index / scale.size;
+                    else expected[k] = expected[k - 7] + 1.f;
+                }
+                int nth = (drop == Voicing::DROP_2) ? 2 : (drop == Voicing::DROP_3) ? 3 : 0;
+                if (nth && numVoices >= nth) {
+                    int order[Voicing::MAX_VOICES];
+                    for (int k = 0; k < numVoices; k++)
+                        order[k] = k;
+                    std::stable_sort(order, order + numVoices, [&](int a, int b) { return expected[a] > expected[b]; });
+                    expected[order[nth - 1]] -= 1.f;
+                }
+
+                const char* names[3] = {"", " drop 2", " drop 3"};
+                Output& poly = m->outputs[ChordCircle::POLY_OUTPUT];
+                ok = CHECK(poly.getChannels() == numVoices, "voicing: %d voices%s on %d POLY channels",
+                           numVoices, names[drop], poly.getChannels());
+                for (int k = 0; k < numVoices && ok; k++)
+                    ok = CHECK(std::fabs(poly.getVoltage(k) - expected[k]) < 1e-5f,
+                               "voicing: %d voices in %s%s, channel %d at %.4fV, expected %.4fV", numVoices,
+                               extension == Voicing::EXTEND_OCTAVES ? "octaves" : "thirds", names[drop], k + 1, poly.getVoltage(k), expected[k]);
+                float chord[4];
+                getChord(*m, *m->pattern, step, chord);
+                ok = ok && CHECK(isPlaying(*m, chord), "voicing: VOICE 1-4 moved with %d voices%s", numVoices, names[drop]);
+            }
+        }
+    }
+    delete m;
+}
+
+// Glide leaves from the voltages playing and lands exactly on the new chord,
+// moving towards it on every sample in between. POLY glides along.
+static void checkGlide() {
+    ChordCircle* m = createModule();
+    connect(m->inputs[ChordCircle::CLOCK_INPUT]);
+    m->params[ChordCircle::SCALE_TYPE_PARAM].setValue(3.f);
+    m->glideMs = 5.f;
+    int64_t frame = 0;
+    runClock(*m, frame, 20000, 10000);   // Edges at 5000 and 15000
+
+    float from[4], to[4];
+    getChord(*m, *m->pattern, m->laneSteps[0], from);
+    CHECK(isPlaying(*m, from), "glide: not settled on step %d", m->laneSteps[0]);
+    getChord(*m, *m->pattern, m->laneSteps[0] + 1, to);
+
+    // The last step may be the 0.1 mV snap onto the target
+    float last[4];
+    std::copy(from, from + 4, last);
+    int64_t landed = -1;
+    bool smooth = true;
+    while (frame < 30000 && landed < 0 && smooth) {
+        runClock(*m, frame, frame + 1, 10000);
+        for (int k = 0; k < 4; k++) {
+            float v = m->outputs[ChordCircle::VOICE_1_OUTPUT + k].getVoltage();
+            float maxStep = m->glideCoefficient * std::fabs(to[k] - last[k]) + 1e-4f;
+            smooth = smooth && CHECK(std::fabs(to[k] - v) <= std::fabs(to[k] - last[k]) && std::fabs(v - last[k]) <= maxStep,
+                "glide: voice %d went from %f to %f at sample %lld, target %f", k + 1, last[k], v, (long long)frame - 1, to[k]);
+            smooth = smooth && CHECK(m->outputs[ChordCircle::POLY_OUTPUT].getVoltage(k) == v, "glide: POLY channel %d differs from VOICE %d", k + 1, k + 1);
+            last[k] = v;
+        }
+        if (std::equal(last, last + 4, to)) landed = frame - 1;
+    }
+    // One-pole to within 0.1 mV from under an octave away: 10 time constants
+    CHECK(landed > 25000 && landed < 25000 + 10 * 5 * 48, "glide: landed at sample %lld, edge at 25000", (long long)landed);
+
+    // Off: the edge lands at once
+    m->glideMs = 0.f;
+    runClock(*m, frame, 35001, 10000);
+    float next[4];
+    getChord(*m, *m->pattern, m->laneSteps[0], next);
+    CHECK(isPlaying(*m, next), "glide off: not on step %d on the edge", m->laneSteps[0]);
+    delete m;
+}
+
+// --- Cost ---
+
+typedef std::chrono::steady_clock Clock;
+
+// Nanoseconds per call of f(i), over `n` calls
+template <typename F>
+static double timePerCall(F f, int n) {
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < n; i++) f(i);
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n;
+}
+
+static double getMedian(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// process() in units of a reference timed alongside it, so the speed of
+// the machine cancels out: the two float_4 Schmitt triggers that CLOCK and
+// RESET cost on every sample. Medians of interleaved rounds, idle, with a
+// control tick on every sample, and under a clock rising every other
+// sample. The ratios still wander by a quarter from run to run, so the
+// limits sit about a third above the slowest runs of this tree. Edges at
+// twice today's cost would not pass them.
+static void checkCost() {
+#ifdef __SANITIZE_ADDRESS__
+    return;   // Sanitized timings mean nothing
+#endif
+    const int ROUNDS = 41;
+    const int SAMPLES = 20000;
+    const double MAX_IDLE = 13.0;
+    const double MAX_TICK = 30.0;
+    const double MAX_AUDIO_RATE = 33.0;
+
+    ChordCircle* m = createModule();
+    Input& clock = m->inputs[ChordCircle::CLOCK_INPUT];
+    connect(clock);
+    int64_t frame = 0;
+    runClock(*m, frame, 10000, 1000);
+    dsp::TSchmittTrigger<float_4> triggers[2];
+    volatile int sink = 0;
+
+    std::vector<double> idle, tick, audioRate;
+    for (int round = 0; round < ROUNDS; round++) {
+        double reference = timePerCall([&](int i) {
+            float_4 v = clock.getVoltageSimd<float_4>(0);
+            sink += simd::movemask(triggers[0].process(v)) + simd::movemask(triggers[1].process(v));
+        }, SAMPLES);
+        clock.setVoltage(0.f);
+        idle.push_back(timePerCall([&](int i) { process(*m, frame++); }, SAMPLES) / reference);
+        m->setControlDivision(0);
+        tick.push_back(timePerCall([&](int i) { process(*m, frame++); }, SAMPLES) / reference);
+        m->setControlDivision(1);
+        audioRate.push_back(timePerCall([&](int i) {
+            clock.setVoltage((i & 1) ? 10.f : 0.f);
+            process(*m, frame++);
+        }, SAMPLES) / reference);
+    }
+    double idleCost = getMedian(idle), tickCost = getMedian(tick), audioRateCost = getMedian(audioRate);
+    std::printf("cost: idle %.1f, control tick %.1f, audio-rate clock %.1f references per sample\n", idleCost, tickCost, audioRateCost);
+    CHECK(idleCost < MAX_IDLE, "cost: idle %.1f references per sample, limit %.1f", idleCost, MAX_IDLE);
+    CHECK(tickCost < MAX_TICK, "cost: control tick %.1f references per sample, limit %.1f", tickCost, MAX_TICK);
+    CHECK(audioRateCost < MAX_AUDIO_RATE, "cost: audio-rate clock %.1f references per sample, limit %.1f", audioRateCost, MAX_AUDIO_RATE);
+    delete m;
+}
+
+int main(int argc, char* argv[]) {
+    std::string goldenDir = "bench/golden";
+    bool update = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--update") update = true;
+        else goldenDir = argv[i];
+    }
+
+    for (const Script& script : SCRIPTS)
+        runScript(script, goldenDir, update);
+    checkChordTable();
+    checkTunings();
+    checkSpreadHysteresis();
+    checkRandomizer();
+    checkStats();
+    checkVoiceLeading();
+    checkPaging();
+    checkPatternSaveLoad();
+    checkClockTracker();
+    checkTrackMode();
+    checkTrackStrum();
+    checkPreparedLanes();
+    checkLaneOutputs();
+    checkChordBus();
+    checkEdgeChords();
+    checkGlide();
+    checkStrum();
+    checkVoicing();
+    checkQuantizer();
+    checkAnalyze();
+    checkHarmonyBus();
+    checkLibraryLifetime();   // Last: it reloads the shared scales
+    checkCost();
+
+    std::printf("%d checks, %d failed%s\n", numChecks, numFailures, update ? ", golden files rewritten" : "");
+    return numFailures ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+#include "AllocGuard.hpp"
+
+#ifdef CHORDCHEMIST_ALLOC_GUARD
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions of the binary this is linked
+// into. Only built in ALLOC_GUARD mode.
+
+namespace AllocGuard {
+
+static thread_local int depth = 0;
+static std::atomic<uint64_t> count(0);
+
+Scope::Scope() { depth++; }
+Scope::~Scope() { depth--; }
+
+uint64_t getCount() {
+    return count.load(std::memory_order_relaxed);
+}
+
+static void check() {
+    if (depth > 0) {
+        count.fetch_add(1, std::memory_order_relaxed);
+#ifdef CHORDCHEMIST_ALLOC_GUARD_ABORT
+        std::abort();
+#endif
+    }
+}
+
+} // namespace AllocGuard
+
+void* operator new(std::size_t size) {
+    AllocGuard::check();
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    AllocGuard::check();
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+#endif
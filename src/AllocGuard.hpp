@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+// Debug allocation guard for the audio thread.
+// `make ALLOC_GUARD=1` counts every heap allocation made while a Scope is
+// alive (ChordCircle::process() opens one), `make ALLOC_GUARD=abort` aborts
+// on the first one. In normal builds Scope is empty and compiles away.
+namespace AllocGuard {
+
+#ifdef CHORDCHEMIST_ALLOC_GUARD
+struct Scope {
+    Scope();
+    ~Scope();
+};
+
+// Allocations seen inside any Scope since startup.
+uint64_t getCount();
+#else
+struct Scope {
+    Scope() {}
+};
+
+inline uint64_t getCount() { return 0; }
+#endif
+
+} // namespace AllocGuard
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * ChordBus.hpp
+ * The chord ChordCircle publishes to the module on its right, through Rack's
+ * double-buffered expander messages. Self-contained plain data, so other
+ * plugins can copy this header as is.
+ *
+ * ChordCircle owns both buffers. A module placed to its right reads:
+ *
+ *     Module* m = leftExpander.module;
+ *     const ChordBus::Message* msg = m ? (const ChordBus::Message*) m->rightExpander.consumerMessage : NULL;
+ *     if (ChordBus::isValid(msg)) { ... }
+ *
+ * The message arrives one sample after ChordCircle wrote it and stays
+ * unchanged for the whole sample, whatever order modules run in. It is only
+ * rewritten when the chord changes; `counter` tells readers that it did.
+ */
+namespace ChordBus {
+
+static const uint32_t MAGIC = 0x43484348;  // "CHCH"
+static const uint32_t VERSION = 1;
+
+struct Message {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t counter;     // Incremented on every change, wraps
+    int32_t root;         // ROOT knob: semitones above C0, 0-60
+    int32_t scale;        // Index in ChordCircle's scale list
+    int32_t degree;       // Scale degree of the chord root, 0-6
+    int32_t quality;      // Fourth voice: 0 7th, 1 octave, 2 6th, 3 9th, 4 11th
+    int32_t step;         // Sequencer step, 0-255
+    float voltages[4];    // VOICE 1-4 outputs, 1V/oct, spread included
+};
+
+static_assert(sizeof(Message) == 48, "ChordBus::Message layout is fixed");
+
+inline bool isValid(const Message* message) {
+    return message && message->magic == MAGIC && message->version == VERSION;
+}
+
+} // namespace ChordBus
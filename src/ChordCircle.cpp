@@ -4,343 +4,160 @@
  * * Current Layout: Knobs at 15.5mm, CV Inputs at 26.5mm.
  */
 
-#include "plugin.hpp"
+#include "ChordCircle.hpp"
+#include <osdialog.h>
 #include <sstream>
-#include <vector>
-#include <string>
-
-using namespace rack;
 
 // =============================================================
-// 1. EMBEDDED THEORY ENGINE
+// 3. UI IMPLEMENTATION
 // =============================================================
-struct TheoryEngine {
-    std::vector<std::vector<int>> SCALES;
-    std::vector<std::string> SCALE_NAMES;
-
-    TheoryEngine() {
-        addScale("Chromatic", {0,1,2,3,4,5,6,7,8,9,10,11});
-        addScale("Tritone", {0,1,4,6,7,10});
-        addScale("Two-Semi Tritone", {0,1,2,6,7,8});
-        
-        addScale("Major (Ionian)", {0,2,4,5,7,9,11});
-        addScale("Major Pentatonic", {0,2,4,7,9});
-        addScale("Major Bebop", {0,2,4,5,7,8,9,11});
-        addScale("Major Locrian", {0,2,4,5,6,8,10});
-        
-        addScale("Natural Minor", {0,2,3,5,7,8,10});
-        addScale("Minor Pentatonic", {0,3,5,7,10});
-        addScale("Harmonic Minor", {0,2,3,5,7,8,11});
-        addScale("Melodic Minor", {0,2,3,5,7,9,11});
-        
-        addScale("Dorian", {0,2,3,5,7,9,10});
-        addScale("Phrygian", {0,1,3,5,7,8,10});
-        addScale("Lydian", {0,2,4,6,7,9,11});
-        addScale("Mixolydian", {0,2,4,5,7,9,10});
-        addScale("Locrian", {0,1,3,5,6,8,10});
-        
-        addScale("Lydian Dominant", {0,2,4,6,7,9,10}); 
-        addScale("Lydian Augmented", {0,2,4,6,8,9,11});
-        addScale("Lydian Diminished", {0,2,3,6,7,9,11}); 
-        
-        addScale("Phrygian Dominant", {0,1,4,5,7,8,10});
-        addScale("Locrian Nat6", {0,1,3,5,6,9,10});
-        addScale("Super Locrian", {0,1,3,4,6,8,10}); 
-        
-        addScale("Blues", {0,3,5,6,7,10});
-        addScale("Double Harmonic", {0,1,4,5,7,8,11}); 
-        addScale("Hungarian Minor", {0,2,3,6,7,8,11}); 
-        addScale("Hungarian Major", {0,3,4,6,7,9,10});
-        addScale("Persian", {0,1,4,5,6,8,11});
-        addScale("Hirajoshi", {0,2,3,7,8});
-        addScale("Iwato", {0,1,5,6,10});
-        addScale("In Sen", {0,1,5,7,10});
-        addScale("Yo", {0,2,5,7,9});
-        
-        addScale("Whole Tone", {0,2,4,6,8,10});
-        addScale("Augmented", {0,3,4,7,8,11});
-        addScale("Octatonic (H-W)", {0,1,3,4,6,7,9,10});
-        addScale("Enigmatic", {0,1,4,6,8,10,11});
-        addScale("Prometheus", {0,2,4,6,9,10});
-        addScale("Harmonic Major", {0,2,4,5,7,8,11});
-        addScale("Neapolitan Maj", {0,1,3,5,7,9,11});
-        addScale("Neapolitan Min", {0,1,3,5,7,8,11});
-        addScale("Bebop Dominant", {0,2,4,5,7,9,10,11});
-        addScale("Algerian", {0,2,3,5,6,7,8,11});
-        addScale("Ukrainian Dorian", {0,2,3,6,7,9,10});
-        addScale("Istrian", {0,1,3,4,6,7});
-    }
 
-    void addScale(std::string name, std::vector<int> notes) {
-        SCALE_NAMES.push_back(name);
-        SCALES.push_back(notes);
+struct StepKnob : Trimpot {
+    int stepIndex = -1;
+    ChordCircle* chordModule = nullptr;
+    uint32_t lastSequence = 1;  // Odd, never a published sequence
+    bool active = false;
+
+    void step() override {
+        if (chordModule) {
+            uint32_t sequence = chordModule->uiSnapshot.getSequence();
+            UiSnapshot s;
+            if (sequence != lastSequence && chordModule->uiSnapshot.tryRead(s)) {
+                active = (s.activeStep == s.page * PAGE_SIZE + stepIndex);
+                lastSequence = sequence;
+            }
+        }
+        Trimpot::step();
     }
-
-    std::string getChordName(int rootNote, int scaleIdx, int degree) {
-        if (scaleIdx < 0 || scaleIdx >= (int)SCALES.size()) return "?";
-        const auto& s = SCALES[scaleIdx];
-        if (s.empty()) return "?";
-
-        const char* noteNames[] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
-        int interval = s[degree % s.size()];
-        int absRoot = (rootNote + interval) % 12;
-        std::string name = noteNames[absRoot];
-
-        int thirdIdx = (degree + 2) % s.size();
-        int fifthIdx = (degree + 4) % s.size();
-        
-        int i3 = (s[thirdIdx] - interval + 12) % 12;
-        int i5 = (s[fifthIdx] - interval + 12) % 12;
-
-        if (i3 == 4) name += "";      
-        else if (i3 == 3) name += "m"; 
-        else if (i3 == 2) name += "sus2"; 
-        else if (i3 == 5) name += "sus4";
-        else name += "?";
-
-        if (i5 == 6) name += "b5";
-        else if (i5 == 8) name += "#5";
-
-        return name;
+    
+    void draw(const DrawArgs& args) override {
+        if (active) {
+            nvgBeginPath(args.vg);
+            nvgCircle(args.vg, box.size.x/2, box.size.y/2, box.size.x/2 + 2.0); 
+            nvgFillColor(args.vg, nvgRGBA(21, 55, 227, 255)); // Blue
+            nvgFill(args.vg);
+        }
+        Trimpot::draw(args);
     }
 };
 
-// =============================================================
-// 2. MODULE DEFINITION
-// =============================================================
-
-struct ChordCircle : Module {
-    enum ParamId {
-        STEPS_COUNT_PARAM,    
-        ROOT_NOTE_PARAM,      
-        SCALE_TYPE_PARAM,     
-        SPREAD_PARAM,         
-        RANDOMIZE_BTN_PARAM,  
-        STEP_DEGREE_PARAM_0,
-        STEP_DEGREE_PARAM_15 = STEP_DEGREE_PARAM_0 + 15,
-        PARAMS_LEN 
-    };
-
-    enum InputId {
-        CLOCK_INPUT,      
-        RESET_INPUT,      
-        ROOT_CV_INPUT,    
-        SCALE_CV_INPUT,
-        SPREAD_CV_INPUT,
-        STEPS_CV_INPUT,
-        RANDOM_CV_INPUT,   
-        STEP_DEGREE_INPUT_0,
-        STEP_DEGREE_INPUT_15 = STEP_DEGREE_INPUT_0 + 15,
-        INPUTS_LEN
-    };
-
-    enum OutputId {
-        VOICE_1_OUTPUT, 
-        VOICE_2_OUTPUT, 
-        VOICE_3_OUTPUT, 
-        VOICE_4_OUTPUT, 
-        POLY_OUTPUT,    
-        OUTPUTS_LEN
-    };
-
-    enum LightId { 
-        VOICE_LIGHT_1, 
-        VOICE_LIGHT_2, 
-        VOICE_LIGHT_3, 
-        VOICE_LIGHT_4, 
-        LIGHTS_LEN 
-    };
-
-    TheoryEngine theory;
-    int currentStep = 0;
-    std::vector<float> currentVoices = {0.f, 0.f, 0.f, 0.f}; 
-    int stepQualities[16];
-
-    dsp::SchmittTrigger clockTrigger;
-    dsp::SchmittTrigger resetTrigger;
-    dsp::SchmittTrigger randomizeTrigger;
-
-    ChordCircle() {
-        config(PARAMS_LEN, INPUTS_LEN, OUTPUTS_LEN, LIGHTS_LEN);
-        
-        configParam(STEPS_COUNT_PARAM, 1.f, 16.f, 8.f, "Seq Length");
-        configParam(ROOT_NOTE_PARAM, 0.f, 60.f, 24.f, "Root Note"); 
-        configParam(SCALE_TYPE_PARAM, 0.f, (float)(theory.SCALES.size() - 1), 0.f, "Scale Type"); 
-        configParam(SPREAD_PARAM, 0.f, 1.f, 0.f, "Voice Spread");
-        configParam(RANDOMIZE_BTN_PARAM, 0.f, 1.f, 0.f, "Randomize Seq");
-        
-        for (int i = 0; i < 16; i++) {
-            configParam(STEP_DEGREE_PARAM_0 + i, 0.f, 6.f, (float)(i % 7), "Step Degree");
-            stepQualities[i] = 0; 
-        }
+// Everything the displays depend on, taken from the module's UI snapshot.
+// The cached framebuffers below are only re-rendered when it changes.
+struct DisplayKey {
+    const ScaleLibrary* library = nullptr;   // Only valid in the frame it was read
+    uint32_t libraryId = 0;
+    int root = 0;
+    int scale = 0;
+    int numSteps = 0;
+    int activeStep = -1;
+    int page = 0;
+    uint8_t degrees[PAGE_SIZE] = {};
+    uint8_t qualities[PAGE_SIZE] = {};
+    float voltages[4] = {};
+    ChordInfo analyzed = ChordInfo::none();
+
+    // Returns false when the snapshot was being written; try again next frame.
+    bool read(ChordCircle* module) {
+        UiSnapshot s;
+        if (!module->uiSnapshot.tryRead(s)) return false;
+        library = module->getLibrary();
+        libraryId = library->id;
+        root = s.root;
+        scale = clamp(s.scale, 0, library->size() - 1);
+        numSteps = s.numSteps;
+        activeStep = s.activeStep;
+        page = s.page;
+        std::memcpy(degrees, s.degrees, sizeof(degrees));
+        std::memcpy(qualities, s.qualities, sizeof(qualities));
+        std::memcpy(voltages, s.voltages, sizeof(voltages));
+        analyzed = s.analyzed;
+        return true;
     }
 
-    std::string getPentatonicChordName(int rootNote, int scaleType, int degree) {
-        const char* notes[] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
-        const auto& s = theory.SCALES[clamp(scaleType, 0, 5)];
-        int chordRootIndex = s[degree % s.size()];
-        int absRoot = (rootNote + chordRootIndex) % 12;
-        std::string noteName = notes[absRoot];
-        if(scaleType==4) return noteName + "6"; 
-        return noteName + "m7";
+    bool sameHarmony(const DisplayKey& o) const {
+        return libraryId == o.libraryId && root % 12 == o.root % 12 && scale == o.scale;
     }
 
-    void process(const ProcessArgs& args) override {
-        bool trigger = false;
-        if (clockTrigger.process(inputs[CLOCK_INPUT].getVoltage())) trigger = true;
-        if (resetTrigger.process(inputs[RESET_INPUT].getVoltage())) {
-            currentStep = 0; trigger = true; 
-        }
-
-        float rndBtn = params[RANDOMIZE_BTN_PARAM].getValue();
-        float rndCv = inputs[RANDOM_CV_INPUT].getVoltage();
-        if (randomizeTrigger.process(rndBtn + rndCv)) {
-            for (int i=0; i<16; i++) {
-                params[STEP_DEGREE_PARAM_0 + i].setValue(std::round(random::uniform() * 6.f));
-                float r = random::uniform();
-                if (r < 0.4) stepQualities[i] = 0;      
-                else if (r < 0.5) stepQualities[i] = 1; 
-                else if (r < 0.7) stepQualities[i] = 2; 
-                else if (r < 0.9) stepQualities[i] = 3; 
-                else stepQualities[i] = 4;              
-            }
-        }
-        
-        // --- ABSOLUTE CV CONTROL (Motorized Knobs) ---
-        // 1. Steps (1V = Step 1, 16V = Step 16)
-        if (inputs[STEPS_CV_INPUT].isConnected()) {
-            float stepsCv = inputs[STEPS_CV_INPUT].getVoltage();
-            params[STEPS_COUNT_PARAM].setValue(clamp(stepsCv, 1.f, 16.f));
-        }
-
-        // 2. Spread (0V = 0%, 10V = 100%)
-        if (inputs[SPREAD_CV_INPUT].isConnected()) {
-            float spreadCv = inputs[SPREAD_CV_INPUT].getVoltage();
-            params[SPREAD_PARAM].setValue(clamp(spreadCv / 10.f, 0.f, 1.f));
-        }
-
-        // 3. Root (1V/Octave standard: 0V=0, 5V=60)
-        if (inputs[ROOT_CV_INPUT].isConnected()) {
-            float rootCv = inputs[ROOT_CV_INPUT].getVoltage();
-            params[ROOT_NOTE_PARAM].setValue(clamp(rootCv * 12.f, 0.f, 60.f));
-        }
-
-        // 4. Scale (Map 0-10V to Full Scale List)
-        if (inputs[SCALE_CV_INPUT].isConnected()) {
-            float scaleCv = inputs[SCALE_CV_INPUT].getVoltage();
-            float maxScale = (float)(theory.SCALES.size() - 1);
-            // Map 0V-10V -> 0-MaxScale
-            float mappedVal = (scaleCv / 10.f) * maxScale;
-            params[SCALE_TYPE_PARAM].setValue(clamp(mappedVal, 0.f, maxScale));
-        }
+    bool sameStep(const DisplayKey& o, int i) const {
+        return degrees[i] == o.degrees[i] && qualities[i] == o.qualities[i];
+    }
 
-        if (trigger) {
-            // Read directly from params (Motorized values)
-            int numSteps = clamp((int)params[STEPS_COUNT_PARAM].getValue(), 1, 16);
-            
-            currentStep = (currentStep + 1) % numSteps;
+    bool operator==(const DisplayKey& o) const {
+        return sameHarmony(o) && root == o.root && numSteps == o.numSteps && activeStep == o.activeStep && page == o.page
+            && std::memcmp(degrees, o.degrees, sizeof(degrees)) == 0
+            && std::memcmp(qualities, o.qualities, sizeof(qualities)) == 0
+            && std::memcmp(voltages, o.voltages, sizeof(voltages)) == 0
+            && std::memcmp(&analyzed, &o.analyzed, sizeof(analyzed)) == 0;
+    }
+};
 
-            int rootInt = (int)params[ROOT_NOTE_PARAM].getValue();
-            // Note: inputs[ROOT_CV_INPUT] is NOT added here, it was applied to the knob above.
-            
-            int scaleInt = (int)params[SCALE_TYPE_PARAM].getValue();
-            // Note: inputs[SCALE_CV_INPUT] is NOT added here, it was applied to the knob above.
-            
-            int degreeParam = STEP_DEGREE_PARAM_0 + currentStep;
-            int degree = (int)params[degreeParam].getValue();
-            int quality = stepQualities[currentStep];
+// A display drawn from a DisplayKey instead of the live module.
+struct CachedDisplay : TransparentWidget {
+    ChordCircle* module = nullptr;
+    DisplayKey key;
 
-            int numScales = theory.SCALES.size();
-            scaleInt = clamp(scaleInt, 0, numScales - 1);
-            
-            const auto& s = theory.SCALES[scaleInt];
-            currentVoices.clear();
-            
-            std::vector<int> intervals;
-            intervals.push_back(0); 
-            intervals.push_back(2); 
-            intervals.push_back(4); 
-            
-            switch (quality) {
-                case 0: intervals.push_back(6); break;  
-                case 1: intervals.push_back(0); break;  
-                case 2: intervals.push_back(5); break;  
-                case 3: intervals.push_back(8); break;  
-                case 4: intervals.push_back(10); break; 
-                default: intervals.push_back(6); break;
-            }
-            
-            for (int k = 0; k < 4; k++) {
-                int interval = intervals[k];
-                int scaleIndexRaw = degree + interval;
-                int scaleIndex = scaleIndexRaw % s.size();
-                int octaveShift = scaleIndexRaw / s.size();
-                int notePitchClass = s[scaleIndex];
-                
-                float v = (rootInt / 12.0f) + (notePitchClass / 12.0f) + (float)octaveShift;
-                currentVoices.push_back(v);
-            }
-        }
+    // Called by the DisplayCache only when the key changed.
+    virtual void update(const DisplayKey& latest) {
+        key = latest;
+    }
 
-        outputs[POLY_OUTPUT].setChannels(4);
-        
-        float spread = params[SPREAD_PARAM].getValue();
-        // Spread is already set by CV above
-        spread = clamp(spread, 0.f, 1.f);
-
-        for (int i = 0; i < 4; i++) {
-            float v = currentVoices[i];
-            if (i == 0 && spread > 0.5f) v -= 1.0f; 
-            outputs[POLY_OUTPUT].setVoltage(v, i);
-            outputs[VOICE_1_OUTPUT + i].setVoltage(v);
-            lights[VOICE_LIGHT_1 + i].setBrightness(1.0f);
-        }
+    // Whether `latest` differs from the key in anything this display draws;
+    // by default the whole key.
+    virtual bool isChanged(const DisplayKey& latest) const {
+        return !(latest == key);
     }
 };
 
-// =============================================================
-// 3. UI IMPLEMENTATION
-// =============================================================
+// Renders one CachedDisplay into a framebuffer and marks it dirty only when
+// what it draws of the module's DisplayKey changes.
+struct DisplayCache : FramebufferWidget {
+    CachedDisplay* display = nullptr;
+    bool valid = false;
+    uint32_t lastSequence = 1;  // Odd, never a published sequence
+    uint32_t lastLibraryId = 0;
 
-struct StepKnob : Trimpot {
-    int stepIndex = -1;
-    
-    void draw(const DrawArgs& args) override {
+    void step() override {
+        ChordCircle* module = display->module;
         if (module) {
-            ChordCircle* m = dynamic_cast<ChordCircle*>(module);
-            if (m && m->currentStep == stepIndex) {
-                nvgBeginPath(args.vg);
-                nvgCircle(args.vg, box.size.x/2, box.size.y/2, box.size.x/2 + 2.0); 
-                nvgFillColor(args.vg, nvgRGBA(21, 55, 227, 255)); // Blue
-                nvgFill(args.vg);
+            uint32_t sequence = module->uiSnapshot.getSequence();
+            uint32_t libraryId = module->getLibrary()->id;
+            DisplayKey latest;
+            if ((sequence != lastSequence || libraryId != lastLibraryId) && latest.read(module)) {
+                lastSequence = sequence;
+                lastLibraryId = libraryId;
+                if (!valid || display->isChanged(latest)) {
+                    display->update(latest);
+                    valid = true;
+                    setDirty();
+                }
             }
         }
-        Trimpot::draw(args);
+        FramebufferWidget::step();
     }
 };
 
-struct ValueDisplay : TransparentWidget {
-    ChordCircle* module = nullptr;
+struct ValueDisplay : CachedDisplay {
     int mode = 0; 
-    const std::vector<std::string> noteNames = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+    std::string text = "?";
 
-    void draw(const DrawArgs& args) override {
-        if (!module) return;
-        std::string text = "?";
+    void update(const DisplayKey& latest) override {
         if (mode == 0) {
-            // Reads the param which is now updated by CV automatically
-            int val = (int)module->params[ChordCircle::ROOT_NOTE_PARAM].getValue();
-            while(val < 0) val += 120;
-            int oct = (val / 12) + 1; 
-            std::string note = noteNames[val % 12];
-            text = note + std::to_string(oct);
+            int oct = (latest.root / 12) + 1; 
+            text = std::string(NOTE_NAMES[latest.root % 12]) + std::to_string(oct);
         } else {
-            // Reads the param which is now updated by CV automatically
-            int val = (int)module->params[ChordCircle::SCALE_TYPE_PARAM].getValue();
-            int max = module->theory.SCALE_NAMES.size() - 1;
-            val = clamp(val, 0, max);
-            text = module->theory.SCALE_NAMES[val];
+            text = latest.library->scales[latest.scale].name;
         }
+        CachedDisplay::update(latest);
+    }
+
+    // The root's name or the scale's, so a new step or chord leaves it alone
+    bool isChanged(const DisplayKey& latest) const override {
+        if (mode == 0) return latest.root != key.root;
+        return latest.libraryId != key.libraryId || latest.scale != key.scale;
+    }
+
+    void draw(const DrawArgs& args) override {
+        if (!module) return;
         nvgFontSize(args.vg, 13);
         nvgFontFaceId(args.vg, APP->window->uiFont->handle);
         nvgFillColor(args.vg, nvgRGBA(21, 55, 227, 255));
@@ -349,34 +166,62 @@ struct ValueDisplay : TransparentWidget {
     }
 };
 
-struct CircleDisplay : TransparentWidget {
-    ChordCircle* module = nullptr;
+struct CircleDisplay : CachedDisplay {
+    std::string names[16];
+    bool namesValid = false;
+    std::string playing;  // Notes currently on VOICE 1-4
+    std::string analyzed; // Chord on the ANALYZE input
+
+    // Chord names are only rebuilt for steps whose degree or quality changed,
+    // or for all of them when root, scale or library changed.
+    void update(const DisplayKey& latest) override {
+        bool harmonyChanged = !namesValid || !latest.sameHarmony(key);
+        int rootPitchClass = latest.root % 12;
+
+        // Named from the notes the step actually plays, on its scale degree
+        for (int i = 0; i < 16; i++) {
+            if (!harmonyChanged && latest.sameStep(key, i)) continue;
+
+            const ChordEntry& chord = latest.library->getChord(latest.scale, latest.degrees[i], latest.qualities[i]);
+            uint16_t set = Quantizer::transpose(chord.mask, rootPitchClass);
+            names[i] = ChordRecognizer::getName(ChordRecognizer::recognize(set, rootPitchClass + chord.rootOffset));
+        }
+        namesValid = true;
+
+        playing.clear();
+        for (int k = 0; k < 4; k++) {
+            int note = (int)std::round(latest.voltages[k] * 12.f);
+            if (k > 0) playing += " ";
+            playing += std::string(NOTE_NAMES[eucMod(note, 12)]) + std::to_string(eucDiv(note, 12) + 1);
+        }
+        analyzed = latest.analyzed.isValid() ? "IN: " + ChordRecognizer::getName(latest.analyzed) : "";
+        CachedDisplay::update(latest);
+    }
+
     void draw(const DrawArgs& args) override {
         if (!module) return;
         float cx = box.size.x / 2.0;
         float cy = box.size.y / 2.6;
-        float radius = 90.0; 
+        // Leaves room below the wheel for the notes playing, above the step
+        // knob labels, and above it for the chord on ANALYZE
+        float radius = 76.0;
         
-        int stepsBase = (int)module->params[ChordCircle::STEPS_COUNT_PARAM].getValue();
-        int numSteps = clamp(stepsBase, 1, 16);
+        // Only the knob page: longer sequences always show 16 segments, the
+        // ones past the end of the sequence left blank
+        int numSteps = std::min(key.numSteps, PAGE_SIZE);
+        int pageSteps = clamp(key.numSteps - key.page * PAGE_SIZE, 0, PAGE_SIZE);
+        int activeStep = key.activeStep - key.page * PAGE_SIZE;
 
         float anglePerStep = (2 * M_PI) / numSteps;
         nvgStrokeWidth(args.vg, 1.5);
-        
-        int rootVal = (int)module->params[ChordCircle::ROOT_NOTE_PARAM].getValue();
-        while(rootVal < 0) rootVal += 120; 
-        int rootPitchClass = rootVal % 12;
-
-        int scale = (int)module->params[ChordCircle::SCALE_TYPE_PARAM].getValue();
-        int maxScale = module->theory.SCALES.size() - 1;
-        scale = clamp(scale, 0, maxScale);
 
         for (int i = 0; i < numSteps; i++) {
             float start = i * anglePerStep - (M_PI / 2);
             float end = (i + 1) * anglePerStep - (M_PI / 2);
 
             nvgBeginPath(args.vg);
-            if (i == module->currentStep) nvgFillColor(args.vg, nvgRGBA(21, 55, 227, 255));
+            if (i == activeStep) nvgFillColor(args.vg, nvgRGBA(21, 55, 227, 255));
+            else if (i >= pageSteps) nvgFillColor(args.vg, nvgRGBA(35, 35, 35, 255));
             else nvgFillColor(args.vg, nvgRGBA(60, 60, 60, 255));
             
             nvgArc(args.vg, cx, cy, radius, start, end, NVG_CW);
@@ -385,33 +230,400 @@ struct CircleDisplay : TransparentWidget {
             nvgFill(args.vg);
             nvgStrokeColor(args.vg, nvgRGBA(220, 151, 40, 255));
             nvgStroke(args.vg);
+            if (i >= pageSteps) continue;
+            
+            float textAngle = start + (anglePerStep / 2);
+            float tx = cx + cos(textAngle) * (radius * 0.75);
+            float ty = cy + sin(textAngle) * (radius * 0.75);
             
-            if (numSteps <= 16) {
-                float textAngle = start + (anglePerStep / 2);
-                float tx = cx + cos(textAngle) * (radius * 0.75);
-                float ty = cy + sin(textAngle) * (radius * 0.75);
-                
-                int deg = (int)module->params[ChordCircle::STEP_DEGREE_PARAM_0 + i].getValue();
-                std::string name;
-                if (scale >= 4 && scale <= 5) name = module->getPentatonicChordName(rootPitchClass, scale, deg); 
-                else name = module->theory.getChordName(rootPitchClass, scale, deg);
-                
-                int qual = module->stepQualities[i];
-                if (qual == 2) name += "6";
-                if (qual == 3) name += "9";
-                if (qual == 4) name += "11";
-                
-                nvgFillColor(args.vg, nvgRGBA(255, 255, 255, 255));
-                nvgFontSize(args.vg, (numSteps > 10) ? 9 : 11);
-                nvgFontFaceId(args.vg, APP->window->uiFont->handle);
-                nvgTextAlign(args.vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
-                nvgText(args.vg, tx, ty, name.c_str(), NULL);
+            nvgFillColor(args.vg, nvgRGBA(255, 255, 255, 255));
+            nvgFontSize(args.vg, (numSteps > 10) ? 9 : 11);
+            nvgFontFaceId(args.vg, APP->window->uiFont->handle);
+            nvgTextAlign(args.vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+            nvgText(args.vg, tx, ty, names[i].c_str(), NULL);
+        }
+
+        // Notes actually being played, octave numbered like the ROOT display
+        nvgFillColor(args.vg, nvgRGBA(21, 55, 227, 255));
+        nvgFontSize(args.vg, 11);
+        nvgText(args.vg, cx, cy + radius + 9, playing.c_str(), NULL);
+        if (!analyzed.empty())
+            nvgText(args.vg, cx, cy - radius - 8, analyzed.c_str(), NULL);
+    }
+};
+
+struct QualityWeightQuantity : Quantity {
+    ChordCircle* module;
+    int quality;
+
+    void setValue(float value) override { module->randomizer.qualityWeights[quality] = clamp(value, 0.f, 1.f); }
+    float getValue() override { return module->randomizer.qualityWeights[quality]; }
+    float getMinValue() override { return 0.f; }
+    float getMaxValue() override { return 1.f; }
+    float getDefaultValue() override { return DEFAULT_QUALITY_WEIGHTS[quality]; }
+    std::string getLabel() override { return QUALITY_NAMES[quality]; }
+};
+
+struct QualityWeightSlider : ui::Slider {
+    QualityWeightSlider(ChordCircle* module, int quality) {
+        QualityWeightQuantity* q = new QualityWeightQuantity;
+        q->module = module;
+        q->quality = quality;
+        quantity = q;
+        box.size.x = 200.f;
+    }
+    ~QualityWeightSlider() {
+        delete quantity;
+    }
+};
+
+// The whole sequence as a ring in the wheel's hub, shown past 16 steps. It
+// has its own framebuffer, redrawn only when the pattern, its length or the
+// knob page change, so a long sequence costs nothing per frame or per step.
+static const float HUB_RADIUS = 34.f;
+
+struct OverviewDisplay : TransparentWidget {
+    OverviewSnapshot overview;
+    bool valid = false;
+
+    void draw(const DrawArgs& args) override {
+        if (!valid || overview.numSteps <= PAGE_SIZE) return;
+        float cx = box.size.x / 2.0;
+        float cy = box.size.y / 2.6;
+
+        nvgBeginPath(args.vg);
+        nvgCircle(args.vg, cx, cy, HUB_RADIUS);
+        nvgFillColor(args.vg, nvgRGBA(30, 30, 30, 255));
+        nvgFill(args.vg);
+        nvgStrokeColor(args.vg, nvgRGBA(220, 151, 40, 255));
+        nvgStrokeWidth(args.vg, 1.0);
+        nvgStroke(args.vg);
+
+        // One cell per step, brighter for higher degrees; the page in orange
+        float anglePerStep = (2 * M_PI) / overview.numSteps;
+        for (int i = 0; i < overview.numSteps; i++) {
+            float start = i * anglePerStep - (M_PI / 2);
+            float end = (i + 1) * anglePerStep - (M_PI / 2);
+            int level = 70 + 25 * overview.degrees[i];
+            bool onPage = i / PAGE_SIZE == overview.page;
+
+            nvgBeginPath(args.vg);
+            nvgArc(args.vg, cx, cy, HUB_RADIUS - 3, start, end, NVG_CW);
+            nvgArc(args.vg, cx, cy, HUB_RADIUS - 13, end, start, NVG_CCW);
+            nvgClosePath(args.vg);
+            if (onPage) nvgFillColor(args.vg, nvgRGBA(220, 151 * level / 220, 40, 255));
+            else nvgFillColor(args.vg, nvgRGBA(level, level, level, 255));
+            nvgFill(args.vg);
+        }
+
+        int numPages = (overview.numSteps + PAGE_SIZE - 1) / PAGE_SIZE;
+        nvgFillColor(args.vg, nvgRGBA(220, 220, 220, 255));
+        nvgFontSize(args.vg, 10);
+        nvgFontFaceId(args.vg, APP->window->uiFont->handle);
+        nvgTextAlign(args.vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(args.vg, cx, cy, string::f("%d/%d", overview.page + 1, numPages).c_str(), NULL);
+    }
+};
+
+struct OverviewCache : FramebufferWidget {
+    ChordCircle* module = nullptr;
+    OverviewDisplay* display = nullptr;
+    uint32_t lastSequence = 1;  // Odd, never a published sequence
+
+    void step() override {
+        if (module) {
+            uint32_t sequence = module->overviewSnapshot.getSequence();
+            if (sequence != lastSequence && module->overviewSnapshot.tryRead(display->overview)) {
+                lastSequence = sequence;
+                display->valid = true;
+                setDirty();
+            }
+        }
+        FramebufferWidget::step();
+    }
+};
+
+// The playing step on the overview ring. Not cached: it is one dot.
+struct OverviewPlayhead : TransparentWidget {
+    ChordCircle* module = nullptr;
+    uint32_t lastSequence = 1;
+    int activeStep = 0;
+    int numSteps = 0;
+
+    void step() override {
+        if (module) {
+            uint32_t sequence = module->uiSnapshot.getSequence();
+            UiSnapshot s;
+            if (sequence != lastSequence && module->uiSnapshot.tryRead(s)) {
+                activeStep = s.activeStep;
+                numSteps = s.numSteps;
+                lastSequence = sequence;
             }
         }
+        TransparentWidget::step();
+    }
+
+    void draw(const DrawArgs& args) override {
+        if (numSteps <= PAGE_SIZE) return;
+        float angle = (activeStep + 0.5f) * (2 * M_PI) / numSteps - (M_PI / 2);
+        nvgBeginPath(args.vg);
+        nvgCircle(args.vg, box.size.x / 2.0 + cos(angle) * (HUB_RADIUS - 8), box.size.y / 2.6 + sin(angle) * (HUB_RADIUS - 8), 3.0);
+        nvgFillColor(args.vg, nvgRGBA(21, 55, 227, 255));
+        nvgFill(args.vg);
+    }
+};
+
+static void appendHistogram(Menu* menu, std::string title, const std::atomic<uint64_t>* histogram) {
+    menu->addChild(createMenuLabel(title));
+    for (int b = 0; b < ProcessStats::NUM_BUCKETS; b++) {
+        uint64_t count = histogram[b].load(std::memory_order_relaxed);
+        if (!count) continue;
+        uint64_t limit = 1ULL << b;
+        std::string range = (b == ProcessStats::NUM_BUCKETS - 1) ? string::f(">= %llu us", (unsigned long long)(limit / 2000))
+            : (limit < 2000) ? string::f("< %llu ns", (unsigned long long)limit)
+            : string::f("< %llu us", (unsigned long long)(limit / 1000));
+        menu->addChild(createMenuLabel(string::f("    %s: %llu", range.c_str(), (unsigned long long)count)));
+    }
+}
+
+static void saveStats(ChordCircle* module) {
+    osdialog_filters* filters = osdialog_filters_parse("JSON:json");
+    char* path = osdialog_file(OSDIALOG_SAVE, NULL, "chordchemist-stats.json", filters);
+    osdialog_filters_free(filters);
+    if (!path) return;
+
+    json_t* rootJ = module->stats.toJson();
+    if (json_dump_file(rootJ, path, JSON_INDENT(2)) != 0)
+        WARN("Could not write %s", path);
+    json_decref(rootJ);
+    std::free(path);
+}
+
+struct StrumSpacingQuantity : Quantity {
+    ChordCircle* module;
+
+    void setValue(float value) override { module->strumMs = clamp(value, 0.f, MAX_STRUM_MS); }
+    float getValue() override { return module->strumMs; }
+    float getMinValue() override { return 0.f; }
+    float getMaxValue() override { return MAX_STRUM_MS; }
+    float getDefaultValue() override { return 30.f; }
+    std::string getLabel() override { return "Spacing"; }
+    std::string getUnit() override { return " ms"; }
+    int getDisplayPrecision() override { return 3; }
+};
+
+struct StrumSpacingSlider : ui::Slider {
+    StrumSpacingSlider(ChordCircle* module) {
+        StrumSpacingQuantity* q = new StrumSpacingQuantity;
+        q->module = module;
+        quantity = q;
+        box.size.x = 200.f;
+    }
+    ~StrumSpacingSlider() {
+        delete quantity;
     }
 };
 
+struct GlideQuantity : Quantity {
+    ChordCircle* module;
+
+    void setValue(float value) override { module->glideMs = clamp(value, 0.f, MAX_GLIDE_MS); }
+    float getValue() override { return module->glideMs; }
+    float getMinValue() override { return 0.f; }
+    float getMaxValue() override { return MAX_GLIDE_MS; }
+    float getDefaultValue() override { return 0.f; }
+    std::string getLabel() override { return "Glide"; }
+    std::string getUnit() override { return " ms"; }
+    int getDisplayPrecision() override { return 3; }
+};
+
+struct GlideSlider : ui::Slider {
+    GlideSlider(ChordCircle* module) {
+        GlideQuantity* q = new GlideQuantity;
+        q->module = module;
+        quantity = q;
+        box.size.x = 200.f;
+    }
+    ~GlideSlider() {
+        delete quantity;
+    }
+};
+
+static const int EDO_CHOICES[] = {12, 17, 19, 22, 24, 31, 41, 53};
+
+// Parses a .scl or .kbm file into a copy of the module's tuning and only
+// hands it over when it loaded.
+static void loadTuningFile(ChordCircle* module, bool mapping) {
+    osdialog_filters* filters = osdialog_filters_parse(mapping ? "Keyboard mapping:kbm" : "Scala scale:scl");
+    char* path = osdialog_file(OSDIALOG_OPEN, NULL, NULL, filters);
+    osdialog_filters_free(filters);
+    if (!path) return;
+
+    Tuning tuning = module->tuning;
+    std::string error;
+    if (mapping ? tuning.loadKeyboardMapping(path, error) : tuning.loadScala(path, error))
+        module->setTuning(tuning);
+    else
+        osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, string::f("Could not load %s: %s", path, error.c_str()).c_str());
+    std::free(path);
+}
+
 struct ChordCircleWidget : ModuleWidget {
+    void step() override {
+        ChordCircle* module = getModule<ChordCircle>();
+        if (module) {
+            module->refreshTuning();
+            // SCALE's range follows the scale list here, on the UI thread that
+            // reads it; the module clamps the knob to whichever list it plays
+            module->paramQuantities[ChordCircle::SCALE_TYPE_PARAM]->maxValue = (float)(module->getLibrary()->size() - 1);
+        }
+        ScaleLibrary::collect();
+        ModuleWidget::step();
+    }
+
+    void appendContextMenu(Menu* menu) override {
+        ChordCircle* module = getModule<ChordCircle>();
+        if (!module) return;
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createIndexSubmenuItem("CV control rate",
+            {"Every sample", "Every 16 samples", "Every 64 samples", "Every 256 samples"},
+            [=]() { return module->controlDivisionIndex; },
+            [=](int index) { module->setControlDivision(index); }
+        ));
+        menu->addChild(createBoolPtrMenuItem("Smooth voice leading", "", &module->voiceLeading));
+        menu->addChild(createBoolPtrMenuItem("Track key changes between clocks", "", &module->trackMode));
+        menu->addChild(new GlideSlider(module));
+
+        std::vector<std::string> voiceLabels;
+        for (int i = 1; i <= Voicing::MAX_VOICES; i++)
+            voiceLabels.push_back(std::to_string(i));
+        menu->addChild(createSubmenuItem("POLY voicing", "", [=](Menu* menu) {
+            menu->addChild(createIndexSubmenuItem("Voices", voiceLabels,
+                [=]() { return module->numVoices - 1; },
+                [=](int index) { module->numVoices = index + 1; }
+            ));
+            menu->addChild(createIndexPtrSubmenuItem("Above voice 4", {"Stacked thirds", "Octave doublings"}, &module->voicingExtension));
+            menu->addChild(createIndexPtrSubmenuItem("Drop", {"None", "Drop 2", "Drop 3"}, &module->voicingDrop));
+        }));
+        menu->addChild(createIndexPtrSubmenuItem("Quantize QNT to", {"Current chord", "Current scale"}, &module->quantizeMode));
+
+        std::vector<std::string> ratioLabels;
+        for (int ratio : CLOCK_RATIOS)
+            ratioLabels.push_back(ratio < 0 ? string::f("/%d", -ratio) : string::f("x%d", ratio));
+        menu->addChild(createSubmenuItem("Clock", "", [=](Menu* menu) {
+            menu->addChild(createIndexPtrSubmenuItem("Steps per pulse", ratioLabels, &module->clockRatioIndex));
+            const ClockTracker& tracker = module->clockTrackers[0];
+            if (tracker.period > 0) {
+                float rate = module->sampleRate;
+                menu->addChild(createMenuLabel(string::f("Tempo: %.1f BPM (one pulse per beat)", 60.f * rate / tracker.period)));
+                menu->addChild(createMenuLabel(string::f("Jitter: %.2f ms", 1000.f * tracker.getJitter() / rate)));
+            }
+            else {
+                menu->addChild(createMenuLabel("Tempo: waiting for clock"));
+            }
+        }));
+
+        std::vector<std::string> patternLabels;
+        for (int i = 0; i < NUM_PATTERNS; i++)
+            patternLabels.push_back(std::to_string(i + 1));
+        menu->addChild(createIndexSubmenuItem("Pattern (switches on next Trig)", patternLabels,
+            [=]() { return module->requestedPattern; },
+            [=](int index) { module->requestedPattern = index; }
+        ));
+
+        menu->addChild(createSubmenuItem("Harmony bus", "", [=](Menu* menu) {
+            menu->addChild(createIndexPtrSubmenuItem("Role", {"Off", "Leader", "Follower"}, &module->harmonyRole));
+            std::vector<std::string> channelLabels(HarmonyBus::CHANNEL_NAMES, HarmonyBus::CHANNEL_NAMES + HarmonyBus::NUM_CHANNELS);
+            menu->addChild(createIndexPtrSubmenuItem("Channel", channelLabels, &module->harmonyChannel));
+            int channel = module->harmonyChannel;
+            bool claimed = module->claimedChannel == channel;
+            std::string status = !HarmonyBus::hasLeader(channel) ? "no leader"
+                : claimed ? "this module leads"
+                : "led by another module";
+            menu->addChild(createMenuLabel(string::f("Channel %s: %s", HarmonyBus::CHANNEL_NAMES[channel], status.c_str())));
+        }));
+
+        std::vector<std::string> divisionLabels;
+        for (int division : STRUM_DIVISIONS)
+            divisionLabels.push_back(string::f("1/%d clock", division));
+        menu->addChild(createSubmenuItem("Strum / arpeggio", "", [=](Menu* menu) {
+            menu->addChild(createIndexPtrSubmenuItem("Mode", {"Off", "Strum", "Arpeggio"}, &module->strumMode));
+            menu->addChild(createIndexPtrSubmenuItem("Order", {"Up", "Down", "Random"}, &module->strumOrder));
+            menu->addChild(new StrumSpacingSlider(module));
+            menu->addChild(createBoolPtrMenuItem("Sync spacing to clock", "", &module->strumSync));
+            menu->addChild(createIndexPtrSubmenuItem("Synced spacing", divisionLabels, &module->strumDivisionIndex));
+        }));
+
+        std::vector<std::string> pageLabels;
+        for (int i = 0; i < NUM_PAGES; i++)
+            pageLabels.push_back(string::f("Steps %d-%d", i * PAGE_SIZE + 1, (i + 1) * PAGE_SIZE));
+        menu->addChild(createIndexPtrSubmenuItem("Knob page", pageLabels, &module->page));
+        menu->addChild(createBoolPtrMenuItem("Knob page follows playhead", "", &module->followPage));
+
+        menu->addChild(createSubmenuItem("Randomize", "", [=](Menu* menu) {
+            menu->addChild(createMenuLabel("Quality weights"));
+            for (int i = 0; i < NUM_QUALITIES; i++)
+                menu->addChild(new QualityWeightSlider(module, i));
+            menu->addChild(createBoolPtrMenuItem("Markov degrees", "", &module->randomizer.markov));
+            menu->addChild(new MenuSeparator);
+            menu->addChild(createMenuLabel(string::f("Seed: %016llx", (unsigned long long)module->randomizer.seed)));
+            menu->addChild(createMenuItem("New seed", "", [=]() { module->randomizer.setSeed(random::u64()); }));
+        }));
+
+        menu->addChild(createSubmenuItem("Tuning", module->tuning.name, [=](Menu* menu) {
+            for (int divisions : EDO_CHOICES) {
+                menu->addChild(createCheckMenuItem(string::f("%d-EDO", divisions), "",
+                    [=]() { Tuning edo; edo.setEdo(divisions); return module->tuning.steps == edo.steps && module->tuning.period == 1.f; },
+                    [=]() { Tuning edo; edo.setEdo(divisions); module->setTuning(edo); }
+                ));
+            }
+            menu->addChild(new MenuSeparator);
+            menu->addChild(createMenuItem("Load Scala scale (.scl)...", "", [=]() { loadTuningFile(module, false); }));
+            menu->addChild(createMenuItem("Load keyboard mapping (.kbm)...", "", [=]() { loadTuningFile(module, true); }));
+            menu->addChild(createMenuItem("Clear keyboard mapping", "", [=]() {
+                Tuning tuning = module->tuning;
+                tuning.offset = 0.f;
+                module->setTuning(tuning);
+            }, module->tuning.offset == 0.f));
+        }));
+
+        const ScaleLibrary* library = ScaleLibrary::current();
+        menu->addChild(createMenuLabel(string::f("Scales: %d built-in, %d user", library->numBuiltin, library->size() - library->numBuiltin)));
+        menu->addChild(createMenuItem("Reload user scales", "", []() { ScaleLibrary::reload(); }));
+
+        menu->addChild(createSubmenuItem("Performance counters", "", [=](Menu* menu) {
+            menu->addChild(createBoolPtrMenuItem("Enabled", "", &module->statsEnabled));
+            const ProcessStats& stats = module->stats;
+            menu->addChild(new MenuSeparator);
+            menu->addChild(createMenuLabel(string::f("Clock edges: %llu", (unsigned long long)stats.clockEdges.load())));
+            menu->addChild(createMenuLabel(string::f("Resets: %llu", (unsigned long long)stats.resets.load())));
+            menu->addChild(createMenuLabel(string::f("Randomizations: %llu", (unsigned long long)stats.randomizations.load())));
+            menu->addChild(createMenuLabel(string::f("Chords prepared: %llu, on an edge: %llu", (unsigned long long)stats.chords.load(),
+                (unsigned long long)stats.edgeChords.load())));
+            menu->addChild(createMenuLabel(string::f("Worst trigger sample: %.2f us", stats.worstTriggerNs.load() / 1000.0)));
+            appendHistogram(menu, "Trigger samples", stats.triggerHistogram);
+            appendHistogram(menu, "Other samples", stats.sampleHistogram);
+            menu->addChild(new MenuSeparator);
+            menu->addChild(createMenuItem("Reset counters", "", [=]() { module->stats.reset(); }));
+            menu->addChild(createMenuItem("Save as JSON...", "", [=]() { saveStats(module); }));
+        }));
+#ifdef CHORDCHEMIST_ALLOC_GUARD
+        menu->addChild(createMenuLabel(string::f("Audio-thread allocations: %llu", (unsigned long long)AllocGuard::getCount())));
+#endif
+    }
+
+    void addCachedDisplay(CachedDisplay* display, ChordCircle* module, Vec pos, Vec size) {
+        DisplayCache* cache = new DisplayCache;
+        cache->box.pos = pos;
+        cache->box.size = size;
+        display->box.size = size;
+        display->module = module;
+        cache->display = display;
+        cache->addChild(display);
+        addChild(cache);
+    }
+
     void addLabel(Vec centerPos, std::string text) {
         Label* label = new Label;
         label->box.pos = centerPos.minus(Vec(30, 0)); 
@@ -438,6 +650,10 @@ struct ChordCircleWidget : ModuleWidget {
         addInput(createInputCentered<PJ301MPort>(mm2px(Vec(leftX, yIn)), module, ChordCircle::CLOCK_INPUT));
         addLabel(mm2px(Vec(leftX+2, (yIn+yGap)-10)), "Reset");
         addInput(createInputCentered<PJ301MPort>(mm2px(Vec(leftX, yIn+yGap)), module, ChordCircle::RESET_INPUT));
+        addLabel(mm2px(Vec(cvX+1, yIn-10)), "QNT");
+        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(cvX, yIn)), module, ChordCircle::QUANTIZE_INPUT));
+        addLabel(mm2px(Vec(cvX+1, (yIn+yGap)-10)), "PAT");
+        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(cvX, yIn+yGap)), module, ChordCircle::PATTERN_CV_INPUT));
         
         // --- SPREAD + CV ---
         addLabel(mm2px(Vec(leftX+2, (yIn+(yGap*2))-10)), "SPREAD");
@@ -467,28 +683,61 @@ struct ChordCircleWidget : ModuleWidget {
         addLabel(mm2px(Vec(rightX-11,(vStart+vGap*4-3) )), "POLY");
         addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(rightX, vStart+vGap*4)), module, ChordCircle::POLY_OUTPUT));
 
+        // --- PER-VOICE GATES (below the CV column, clear of the wheel) ---
+        addLabel(mm2px(Vec(41, 85.5)), "GATE");
+        float gateX[4] = {leftX, cvX, 36, 46};
+        for (int i = 0; i < 4; i++)
+            addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(gateX[i], 92)), module, ChordCircle::GATE_1_OUTPUT + i));
+
+        // --- CHORD ANALYZER INPUT (named below the wheel) ---
+        addLabel(mm2px(Vec(rightX-11, 89)), "ANA");
+        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(rightX, 92)), module, ChordCircle::ANALYZE_INPUT));
+
+        // --- PER-LANE POLY OUTPUTS (one channel per clock channel) ---
+        float laneX = 101;
+        addLabel(mm2px(Vec(laneX+1, vStart-11)), "LANES");
+        for (int i = 0; i < 4; i++)
+            addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(laneX, vStart+vGap*i)), module, ChordCircle::LANE_VOICE_1_OUTPUT + i));
+
+        // --- QUANTIZER OUTPUT (input is at the top left) ---
+        addLabel(mm2px(Vec(laneX+1, vStart+vGap*4+7)), "QNT");
+        addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(laneX, vStart+vGap*4)), module, ChordCircle::QUANTIZE_OUTPUT));
+
         float topY = 19;
         addLabel(mm2px(Vec(midX-19, topY-11)), "ROOT");
         addParam(createParamCentered<RoundBlackKnob>(mm2px(Vec(midX-21, topY)), module, ChordCircle::ROOT_NOTE_PARAM));
         ValueDisplay* rootDisp = new ValueDisplay();
-        rootDisp->box.pos = mm2px(Vec(midX-26, topY+5)); rootDisp->box.size = mm2px(Vec(10, 8));
-        rootDisp->module = module; rootDisp->mode = 0; addChild(rootDisp);
+        rootDisp->mode = 0;
+        addCachedDisplay(rootDisp, module, mm2px(Vec(midX-26, topY+5)), mm2px(Vec(10, 8)));
         
         addInput(createInputCentered<PJ301MPort>(mm2px(Vec(midX-10, topY)), module, ChordCircle::ROOT_CV_INPUT));
 
         addLabel(mm2px(Vec(midX+17, topY-11)), "SCALE");
         addParam(createParamCentered<RoundBlackKnob>(mm2px(Vec(midX+16, topY)), module, ChordCircle::SCALE_TYPE_PARAM));
+        // Wider than the text box it replaces: scale names overflow 10mm and
+        // the framebuffer clips to its box.
         ValueDisplay* scaleDisp = new ValueDisplay();
-        scaleDisp->box.pos = mm2px(Vec(midX+11, topY+5)); scaleDisp->box.size = mm2px(Vec(10, 8));
-        scaleDisp->module = module; scaleDisp->mode = 1; addChild(scaleDisp);
+        scaleDisp->mode = 1;
+        addCachedDisplay(scaleDisp, module, mm2px(Vec(midX+1, topY+5)), mm2px(Vec(30, 8)));
         
         addInput(createInputCentered<PJ301MPort>(mm2px(Vec(midX+27, topY)), module, ChordCircle::SCALE_CV_INPUT));
         
         CircleDisplay* display = new CircleDisplay();
-        display->box.pos = mm2px(Vec(midX-40, 32)); 
-        display->box.size = mm2px(Vec(80, 80));
-        display->module = module;
-        addChild(display);
+        addCachedDisplay(display, module, mm2px(Vec(midX-40, 32)), mm2px(Vec(80, 80)));
+
+        OverviewCache* overviewCache = new OverviewCache;
+        overviewCache->box.pos = mm2px(Vec(midX-40, 32));
+        overviewCache->box.size = mm2px(Vec(80, 80));
+        overviewCache->module = module;
+        overviewCache->display = new OverviewDisplay;
+        overviewCache->display->box.size = overviewCache->box.size;
+        overviewCache->addChild(overviewCache->display);
+        addChild(overviewCache);
+
+        OverviewPlayhead* playhead = new OverviewPlayhead;
+        playhead->box = overviewCache->box;
+        playhead->module = module;
+        addChild(playhead);
 
         for (int i = 0; i < 16; i++) {
             int row = i / 8; int col = i % 8; 
@@ -498,6 +747,7 @@ struct ChordCircleWidget : ModuleWidget {
             
             StepKnob* k = createParamCentered<StepKnob>(mm2px(Vec(x, y)), module, ChordCircle::STEP_DEGREE_PARAM_0 + i);
             k->stepIndex = i; 
+            k->chordModule = module;
             addParam(k);
         }
     }
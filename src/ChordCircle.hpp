@@ -0,0 +1,1366 @@
+#pragma once
+/**
+ * ChordCircle.hpp
+ * The ChordCircle module. Kept apart from the widgets in ChordCircle.cpp so
+ * the headless bench can build the module alone.
+ */
+
+#include "plugin.hpp"
+#include "AllocGuard.hpp"
+#include "ScaleLibrary.hpp"
+#include "Tuning.hpp"
+#include "SeqLock.hpp"
+#include "ChordBus.hpp"
+#include "VoiceLeading.hpp"
+#include "Xoshiro.hpp"
+#include "ProcessStats.hpp"
+#include "Quantizer.hpp"
+#include "ChordRecognizer.hpp"
+#include "StrumScheduler.hpp"
+#include "HarmonyBus.hpp"
+#include "Voicing.hpp"
+#include "ClockTracker.hpp"
+#include <vector>
+#include <string>
+
+using namespace rack;
+using simd::float_4;
+
+// =============================================================
+// 2. MODULE DEFINITION
+// =============================================================
+
+// Control-rate divisions offered in the context menu.
+static const int CONTROL_DIVISIONS[] = {1, 16, 64, 256};
+static const int NUM_CONTROL_DIVISIONS = sizeof(CONTROL_DIVISIONS) / sizeof(CONTROL_DIVISIONS[0]);
+
+// Quantizes a motorized CV to whole param steps. The held step only moves
+// once the input leaves it by more than CV_HYSTERESIS, so a noisy CV sitting
+// on a boundary cannot flicker between neighbouring values.
+static const float CV_HYSTERESIS = 0.2f;
+
+struct CvQuantizer {
+    int value = 0;
+    bool held = false;
+
+    // Returns true when the quantized value changed.
+    bool process(float x) {
+        if (held && x >= value - CV_HYSTERESIS && x < value + 1 + CV_HYSTERESIS) return false;
+        value = (int)std::floor(x);
+        held = true;
+        return true;
+    }
+
+    void reset() { held = false; }
+};
+
+static const int NUM_PATTERNS = 64;
+static const int MAX_STEPS = 256;
+static const int PAGE_SIZE = 16;
+static const int NUM_PAGES = MAX_STEPS / PAGE_SIZE;
+
+// What the widgets draw. Published by the audio thread through a seqlock
+// whenever it changes; the UI never reads params or lane state directly.
+struct UiSnapshot {
+    int32_t activeStep;
+    int32_t root;
+    int32_t scale;
+    int32_t numSteps;
+    int32_t page;                   // Knob page, within numSteps
+    uint8_t degrees[PAGE_SIZE];     // Of that page
+    uint8_t qualities[PAGE_SIZE];
+    float voltages[4];   // As written to VOICE 1-4, spread included
+    ChordInfo analyzed;  // Chord on the ANALYZE input, invalid when unpatched
+};
+
+// The whole sequence, for the overview. Published like UiSnapshot, but only
+// when the pattern, its length or the page changed, since it is much larger.
+struct OverviewSnapshot {
+    uint32_t pattern;
+    uint32_t revision;
+    int32_t numSteps;
+    int32_t page;
+    uint8_t degrees[MAX_STEPS];
+    uint8_t qualities[MAX_STEPS];
+};
+
+// One sequence of the pattern bank: a scale degree and a chord quality per
+// step, up to MAX_STEPS. The 16 step knobs edit one page of it at a time.
+
+struct Pattern {
+    uint8_t degrees[MAX_STEPS];
+    uint8_t qualities[MAX_STEPS];
+    // Bumped by every edit, so the prepared chords can tell the pattern
+    // changed without comparing all of it
+    uint32_t revision = 0;
+
+    static uint8_t getDefaultDegree(int step) {
+        return step % 7;
+    }
+
+    // Matches the step knob defaults
+    void init() {
+        for (int i = 0; i < MAX_STEPS; i++) {
+            degrees[i] = getDefaultDegree(i);
+            qualities[i] = 0;
+        }
+        revision++;
+    }
+
+    bool isDefault() const {
+        return getLength() == 0;
+    }
+
+    // Steps up to the last one that differs from init()
+    int getLength() const {
+        for (int i = MAX_STEPS; i > 0; i--)
+            if (degrees[i - 1] != getDefaultDegree(i - 1) || qualities[i - 1] != 0) return i;
+        return 0;
+    }
+
+    void copySteps(const Pattern& other, int numSteps) {
+        std::memcpy(degrees, other.degrees, numSteps);
+        std::memcpy(qualities, other.qualities, numSteps);
+        revision++;
+    }
+
+    // Two digits per step, degree then quality. At least 16 steps, as
+    // before long patterns; later steps are left out while at their defaults.
+    std::string toString() const {
+        int length = std::max(getLength(), PAGE_SIZE);
+        std::string s(2 * length, '0');
+        for (int i = 0; i < length; i++) {
+            s[2 * i] = '0' + degrees[i];
+            s[2 * i + 1] = '0' + qualities[i];
+        }
+        return s;
+    }
+
+    bool fromString(const char* s) {
+        size_t length = s ? std::strlen(s) : 0;
+        if (length == 0 || length % 2 || length > 2 * MAX_STEPS) return false;
+        init();
+        for (size_t i = 0; i < length / 2; i++) {
+            degrees[i] = clamp(s[2 * i] - '0', 0, NUM_DEGREES - 1);
+            qualities[i] = clamp(s[2 * i + 1] - '0', 0, NUM_QUALITIES - 1);
+        }
+        return true;
+    }
+};
+
+// Strum spacings offered when synced to the clock, as divisions of its period.
+static const int STRUM_DIVISIONS[] = {2, 3, 4, 6, 8, 12, 16};
+static const int NUM_STRUM_DIVISIONS = sizeof(STRUM_DIVISIONS) / sizeof(STRUM_DIVISIONS[0]);
+static const float MAX_STRUM_MS = 500.f;
+static const float MAX_GLIDE_MS = 2000.f;
+
+// Steps per clock pulse: negative divides, positive multiplies.
+static const int CLOCK_RATIOS[] = {-16, -8, -4, -3, -2, 1, 2, 3, 4};
+static const int NUM_CLOCK_RATIOS = sizeof(CLOCK_RATIOS) / sizeof(CLOCK_RATIOS[0]);
+static const int DEFAULT_CLOCK_RATIO = 5;
+// A longer gap between pulses restarts the tempo estimate
+static const float MAX_CLOCK_SECONDS = 10.f;
+
+// Default quality odds of the randomizer, in QUALITY_EXTENSIONS order.
+static const float DEFAULT_QUALITY_WEIGHTS[NUM_QUALITIES] = {0.4f, 0.1f, 0.2f, 0.2f, 0.1f};
+
+// Degree transition weights of the Markov mode, [from][to], loosely after
+// common-practice harmony: ii and IV lead to V, V and vii resolve to I.
+static const float MARKOV_DEGREE_WEIGHTS[NUM_DEGREES][NUM_DEGREES] = {
+    {1.0f, 2.0f, 1.0f, 3.0f, 3.0f, 2.0f, 0.5f},  // I
+    {1.0f, 0.5f, 0.5f, 1.0f, 4.0f, 0.5f, 1.0f},  // ii
+    {1.0f, 1.0f, 0.5f, 2.0f, 1.0f, 3.0f, 0.2f},  // iii
+    {3.0f, 1.5f, 0.5f, 0.5f, 3.0f, 1.0f, 1.0f},  // IV
+    {4.0f, 0.5f, 0.5f, 1.0f, 0.5f, 2.0f, 0.3f},  // V
+    {1.0f, 3.0f, 1.0f, 3.0f, 2.0f, 0.5f, 0.3f},  // vi
+    {4.0f, 0.3f, 1.0f, 0.3f, 1.0f, 1.0f, 0.2f},  // vii
+};
+
+// Rewrites a pattern from the module's own seeded PRNG, one step per call,
+// so a randomize trigger never spends a whole sample on a long sequence. The
+// steps go to a scratch pattern that is taken over in one piece when done:
+// as many samples as there are steps, 256 (5.3 ms at 48 kHz) at most.
+struct PatternRandomizer {
+    Xoshiro128 rng;
+    uint64_t seed = 0;
+    float qualityWeights[NUM_QUALITIES];
+    bool markov = false;   // Degrees follow MARKOV_DEGREE_WEIGHTS from the previous step
+
+    Pattern scratch;
+    int nextStep = -1;     // -1 while idle
+    int numSteps = 0;      // Steps being rewritten
+
+    PatternRandomizer() {
+        std::copy(DEFAULT_QUALITY_WEIGHTS, DEFAULT_QUALITY_WEIGHTS + NUM_QUALITIES, qualityWeights);
+    }
+
+    void setSeed(uint64_t s) {
+        seed = s;
+        rng.setSeed(s);
+    }
+
+    // Rewrites the first `length` steps. Triggers arriving during a rewrite
+    // (one sample per step) are merged into it.
+    void start(int length) {
+        if (isBusy()) return;
+        nextStep = 0;
+        numSteps = clamp(length, 1, MAX_STEPS);
+    }
+
+    bool isBusy() const {
+        return nextStep >= 0;
+    }
+
+    // Randomizes the next step. Returns true when scratch is complete.
+    bool process() {
+        int i = nextStep;
+        if (markov)
+            scratch.degrees[i] = (i == 0) ? 0 : pick(MARKOV_DEGREE_WEIGHTS[scratch.degrees[i - 1]], NUM_DEGREES);
+        else
+            scratch.degrees[i] = (uint8_t)std::round(rng.uniform() * 6.f);
+        scratch.qualities[i] = pick(qualityWeights, NUM_QUALITIES);
+
+        nextStep = (i + 1 < numSteps) ? i + 1 : -1;
+        return nextStep < 0;
+    }
+
+    int pick(const float* weights, int n) {
+        float total = 0.f;
+        for (int j = 0; j < n; j++)
+            total += weights[j];
+        float r = rng.uniform() * total;
+        for (int j = 0; j < n - 1; j++) {
+            if (r < weights[j]) return j;
+            r -= weights[j];
+        }
+        return n - 1;
+    }
+};
+
+// Everything the upcoming chords depend on. Compared with memcmp on each
+// control tick; every byte is a field, so filling it in leaves no padding
+// to clear first.
+struct ChordKey {
+    const ScaleLibrary* library;
+    int32_t root;
+    int32_t scale;
+    int32_t numSteps;
+    int32_t numLanes;
+    int32_t pattern;           // The one the next edge plays
+    uint32_t revision;         // Of the pattern
+    int32_t activePattern;     // The one playing now, which track mode re-voices
+    uint32_t activeRevision;
+    int32_t followDegree;      // The harmony bus leader's chord, or -1
+    int32_t followQuality;
+    int32_t openVoicing;
+    int32_t voiceLeading;
+};
+static_assert(sizeof(ChordKey) == sizeof(void*) + 12 * sizeof(int32_t), "ChordKey must have no padding");
+
+struct ChordCircle : Module {
+    enum ParamId {
+        STEPS_COUNT_PARAM,    
+        ROOT_NOTE_PARAM,      
+        SCALE_TYPE_PARAM,     
+        SPREAD_PARAM,         
+        RANDOMIZE_BTN_PARAM,  
+        STEP_DEGREE_PARAM_0,
+        STEP_DEGREE_PARAM_15 = STEP_DEGREE_PARAM_0 + 15,
+        PARAMS_LEN 
+    };
+
+    enum InputId {
+        CLOCK_INPUT,      
+        RESET_INPUT,      
+        ROOT_CV_INPUT,    
+        SCALE_CV_INPUT,
+        SPREAD_CV_INPUT,
+        STEPS_CV_INPUT,
+        RANDOM_CV_INPUT,   
+        STEP_DEGREE_INPUT_0,
+        STEP_DEGREE_INPUT_15 = STEP_DEGREE_INPUT_0 + 15,
+        PATTERN_CV_INPUT,
+        QUANTIZE_INPUT,
+        ANALYZE_INPUT,
+        INPUTS_LEN
+    };
+
+    enum OutputId {
+        VOICE_1_OUTPUT, 
+        VOICE_2_OUTPUT, 
+        VOICE_3_OUTPUT, 
+        VOICE_4_OUTPUT, 
+        POLY_OUTPUT,    
+        LANE_VOICE_1_OUTPUT,
+        LANE_VOICE_2_OUTPUT,
+        LANE_VOICE_3_OUTPUT,
+        LANE_VOICE_4_OUTPUT,
+        QUANTIZE_OUTPUT,
+        GATE_1_OUTPUT,
+        GATE_2_OUTPUT,
+        GATE_3_OUTPUT,
+        GATE_4_OUTPUT,
+        OUTPUTS_LEN
+    };
+
+    enum LightId { 
+        VOICE_LIGHT_1, 
+        VOICE_LIGHT_2, 
+        VOICE_LIGHT_3, 
+        VOICE_LIGHT_4, 
+        LIGHTS_LEN 
+    };
+
+    static const int MAX_LANES = 16;
+    static const int ALL_LANES = (1 << MAX_LANES) - 1;
+
+    enum QuantizeMode {
+        QUANTIZE_CHORD,
+        QUANTIZE_SCALE,
+        NUM_QUANTIZE_MODES
+    };
+
+    // Shared by every instance; re-read on each control tick to pick up reloads.
+    // The reader tells the UI thread when a replaced library is let go.
+    const ScaleLibrary* library = ScaleLibrary::current();
+    ScaleLibrary::Reader libraryReader;
+    // The menu's tuning and, unless it is 12-TET, this instance's own library
+    // built from it. The tuning is only touched by the UI thread; the audio
+    // thread just loads the pointer.
+    Tuning tuning;
+    std::atomic<const ScaleLibrary*> tunedLibrary{nullptr};
+
+    // The pattern bank lives in the module, so switching is a pointer swap
+    // on the clock edge. The step knobs edit the active pattern and follow it
+    // on the next control tick after a switch.
+    Pattern patterns[NUM_PATTERNS];
+    Pattern* pattern = &patterns[0];
+    int requestedPattern = 0;   // Menu selection, or PATTERN CV when patched
+    uint8_t knobDegrees[PAGE_SIZE];   // Step knob positions as of the last sync
+    float knobValues[PAGE_SIZE] = {};  // And their raw values, to spot a moved knob
+    // Set when the knobs must follow the pattern: a switch, a randomize or a
+    // new page. Anything else that edits a pattern directly sets it too.
+    bool knobsDirty = true;
+    // The knobs edit steps page * PAGE_SIZE onwards. `knobPage` is that page
+    // kept within the sequence length, as of the last control tick.
+    int page = 0;
+    bool followPage = false;    // Page follows lane 0 while it plays
+    int knobPage = 0;
+
+    // Each channel of a polyphonic clock drives its own lane over the shared
+    // step knobs. Lane 0 feeds the mono outputs and the display.
+    int numLanes = 1;
+    int laneSteps[MAX_LANES] = {};
+    float laneVoices[4][MAX_LANES] = {};  // [voice][lane], so lanes load as float_4
+    // getChordId() of what each lane's voices were built from, -1 before its
+    // first chord
+    int32_t laneChords[MAX_LANES];
+
+    // Lead each new chord from the previous one instead of root position
+    bool voiceLeading = false;
+    // Re-voice the chords being played as soon as the key changes, rather
+    // than on the next clock
+    bool trackMode = false;
+
+    // The chord each lane plays on its next clock and on its next reset,
+    // computed ahead of the edge. A trigger only copies the prepared voices
+    // to the outputs, then prepares the following step.
+    ChordKey preparedKey;
+    int nextSteps[MAX_LANES] = {};
+    int resetSteps[MAX_LANES] = {};
+    float nextVoices[4][MAX_LANES] = {};
+    float resetVoices[4][MAX_LANES] = {};
+    int32_t nextChords[MAX_LANES] = {};
+    int32_t resetChords[MAX_LANES] = {};
+
+    dsp::TSchmittTrigger<float_4> clockTriggers[MAX_LANES / 4];
+    // Per lane tempo and clock ratio; lane 0's tempo is shown in the menu
+    ClockTracker clockTrackers[MAX_LANES];
+    int clockRatioIndex = DEFAULT_CLOCK_RATIO;
+    dsp::TSchmittTrigger<float_4> resetTriggers[MAX_LANES / 4];
+    dsp::SchmittTrigger randomizeTrigger;
+    PatternRandomizer randomizer;
+
+    // ~94 Hz at 48 kHz: faster than any UI frame rate, cheap on the audio thread.
+    static const int SNAPSHOT_DIVISION = 512;
+
+    SeqLock<UiSnapshot> uiSnapshot;
+    UiSnapshot lastSnapshot;
+    dsp::ClockDivider snapshotDivider;
+    SeqLock<OverviewSnapshot> overviewSnapshot;
+    uint32_t overviewKey[4] = {};   // pattern, revision, numSteps, page last published
+
+    // Chord published to the right expander. The module owns both buffers of
+    // rightExpander. `bus` is the last published message, `busNext` what lane
+    // 0 plays now.
+    ChordBus::Message busMessages[2];
+    ChordBus::Message bus;
+    ChordBus::Message busNext;
+
+    // QNT input to output, snapped to lane 0's chord or to the current scale
+    int quantizeMode = QUANTIZE_CHORD;
+    Quantizer quantizer;
+    bool quantizing = true;   // Cleared once QNT out has been silenced
+
+    ChordInfo analyzedChord = ChordInfo::none();
+
+    // Lane 0's chord spread over time for VOICE 1-4, POLY and GATE 1-4.
+    // `playing` is what those outputs play, which lags laneVoices while a
+    // strum is under way.
+    StrumScheduler strum;
+    int strumMode = StrumScheduler::MODE_OFF;
+    int strumOrder = StrumScheduler::ORDER_UP;
+    bool strumSync = false;       // Spacing from strumDivisionIndex instead of strumMs
+    float strumMs = 30.f;
+    int strumDivisionIndex = 4;   // 1/8 clock
+    float playing[4] = {};
+    // Strum off: the gates closed on the edge open on the next sample without
+    // going through the scheduler
+    bool gatesOpening = false;
+    // Glide for VOICE 1-4 and POLY, off at 0. The four voices move together
+    // as one float_4, one-pole towards playing[] plus the spread offset.
+    float glideMs = 0.f;
+    float glideCoefficient = 1.f;
+    float glideCoefficientMs = 0.f;   // The glide time it was worked out for
+    float_4 glideVoltages = 0.f;
+    float_4 spreadOffsets = 0.f;
+    // LANE VOICE 1-4 as last written: which were patched, for how many lanes
+    int laneOutputsPatched = 0;
+    int laneOutputsLanes = 0;
+
+    // POLY carries lane 0's chord spread over numVoices channels by
+    // Voicing::build(). Channels 1-4 follow playing[], strum and glide
+    // included, moved by voicingShifts[] when dropped; the channels above
+    // change on the edge.
+    int numVoices = 4;
+    int voicingExtension = Voicing::EXTEND_THIRDS;
+    int voicingDrop = Voicing::DROP_NONE;
+    float voicing[Voicing::MAX_VOICES] = {};
+    float voicingShifts[4] = {};
+    int builtVoicing[3] = {4, Voicing::EXTEND_THIRDS, Voicing::DROP_NONE};  // What voicing[] was built with
+    uint32_t sampleTime = 0;   // The scheduler's clock; stands still while it is empty
+    float sampleRate = 44100.f;
+    uint32_t maxClockInterval = (uint32_t)(MAX_CLOCK_SECONDS * 44100.f);   // A stopped clock, in samples
+
+    // Harmony bus. The menu sets role and channel; the audio thread claims
+    // and releases channels itself, so a slot never has two writers.
+    int harmonyRole = HarmonyBus::ROLE_OFF;
+    int harmonyChannel = 0;
+    int claimedChannel = -1;
+    bool harmonyPublished = false;
+    HarmonyState harmonyState;
+    int followedChannel = -1;
+    uint32_t followedSequence = 0;
+    int followDegree = -1;        // The leader's chord, while following one
+    int followQuality = 0;
+
+    // Off by default; when off, process() pays a single branch for it
+    bool statsEnabled = false;
+    ProcessStats stats;
+
+    dsp::ClockDivider controlDivider;
+    int controlDivisionIndex = 1;
+    CvQuantizer stepsCvQuantizer;
+    CvQuantizer spreadCvQuantizer;
+    CvQuantizer rootCvQuantizer;
+    CvQuantizer scaleCvQuantizer;
+    CvQuantizer patternCvQuantizer;
+
+    ChordCircle() {
+        ScaleLibrary::addReader(&libraryReader);
+        config(PARAMS_LEN, INPUTS_LEN, OUTPUTS_LEN, LIGHTS_LEN);
+        
+        configParam(STEPS_COUNT_PARAM, 1.f, (float)MAX_STEPS, 8.f, "Seq Length");
+        configParam(ROOT_NOTE_PARAM, 0.f, 60.f, 24.f, "Root Note"); 
+        configParam(SCALE_TYPE_PARAM, 0.f, (float)(library->size() - 1), 0.f, "Scale Type"); 
+        configParam(SPREAD_PARAM, 0.f, 1.f, 0.f, "Voice Spread");
+        configParam(RANDOMIZE_BTN_PARAM, 0.f, 1.f, 0.f, "Randomize Seq");
+        
+        for (int i = 0; i < 16; i++)
+            configParam(STEP_DEGREE_PARAM_0 + i, 0.f, 6.f, (float)(i % 7), "Step Degree");
+        initPatterns();
+        setControlDivision(controlDivisionIndex);
+        snapshotDivider.setDivision(SNAPSHOT_DIVISION);
+        std::memset(&lastSnapshot, 0, sizeof(lastSnapshot));
+        randomizer.setSeed(random::u64());
+        strum.rng.setSeed(random::u64());
+        std::fill(laneChords, laneChords + MAX_LANES, -1);
+        readChordKey(preparedKey);
+        prepareLanes(ALL_LANES, ALL_LANES);
+        updateQuantizer();
+        publishSnapshot(true);
+
+        std::memset(&bus, 0, sizeof(bus));
+        bus.magic = ChordBus::MAGIC;
+        bus.version = ChordBus::VERSION;
+        // The chord of step 1 until the first clock
+        bus.root = preparedKey.root;
+        bus.scale = preparedKey.scale;
+        bus.degree = getStepDegree(0);
+        bus.quality = getStepQuality(0);
+        busMessages[0] = busMessages[1] = busNext = bus;
+        rightExpander.producerMessage = &busMessages[0];
+        rightExpander.consumerMessage = &busMessages[1];
+    }
+
+    ~ChordCircle() {
+        // Removed from the engine by now, so this thread may let go for it
+        if (claimedChannel >= 0) HarmonyBus::release(claimedChannel, this);
+        ScaleLibrary::removeReader(&libraryReader);
+        ScaleLibrary::retire(tunedLibrary.load(std::memory_order_acquire));
+    }
+
+    void initPatterns() {
+        for (Pattern& p : patterns)
+            p.init();
+        selectPattern(0);
+    }
+
+    // Makes a pattern active at once, knobs included. Only for loading and
+    // resetting; while running, patterns switch on the clock edge.
+    void selectPattern(int index) {
+        requestedPattern = clamp(index, 0, NUM_PATTERNS - 1);
+        pattern = &patterns[requestedPattern];
+        std::memcpy(knobDegrees, pattern->degrees + knobPage * PAGE_SIZE, sizeof(knobDegrees));
+        knobsDirty = true;
+    }
+
+    int getPatternIndex() const {
+        return pattern - patterns;
+    }
+
+    void onReset(const ResetEvent& e) override {
+        Module::onReset(e);
+        initPatterns();
+    }
+
+    // Either thread. The tuned library while there is one, else the shared one.
+    const ScaleLibrary* getLibrary() const {
+        const ScaleLibrary* tuned = tunedLibrary.load(std::memory_order_acquire);
+        return tuned ? tuned : ScaleLibrary::current();
+    }
+
+    // UI thread only: builds the tables here and hands them over in one
+    // store. The old ones are freed once the audio thread has moved on.
+    void setTuning(const Tuning& newTuning) {
+        tuning = newTuning;
+        const ScaleLibrary* tuned = tuning.isStandard() ? nullptr : ScaleLibrary::buildTuned(tuning);
+        ScaleLibrary::retire(tunedLibrary.exchange(tuned, std::memory_order_acq_rel));
+    }
+
+    // UI thread only: remaps the tuning onto reloaded user scales.
+    void refreshTuning() {
+        const ScaleLibrary* tuned = tunedLibrary.load(std::memory_order_acquire);
+        if (tuned && tuned->base != ScaleLibrary::current())
+            setTuning(tuning);
+    }
+
+    void setControlDivision(int index) {
+        controlDivisionIndex = clamp(index, 0, NUM_CONTROL_DIVISIONS - 1);
+        controlDivider.setDivision(CONTROL_DIVISIONS[controlDivisionIndex]);
+    }
+
+    json_t* dataToJson() override {
+        json_t* rootJ = json_object();
+        json_object_set_new(rootJ, "controlDivision", json_integer(CONTROL_DIVISIONS[controlDivisionIndex]));
+        json_object_set_new(rootJ, "voiceLeading", json_boolean(voiceLeading));
+        json_object_set_new(rootJ, "statsEnabled", json_boolean(statsEnabled));
+        json_object_set_new(rootJ, "quantizeMode", json_integer(quantizeMode));
+        json_object_set_new(rootJ, "harmonyRole", json_integer(harmonyRole));
+        json_object_set_new(rootJ, "harmonyChannel", json_integer(harmonyChannel));
+        json_object_set_new(rootJ, "strumMode", json_integer(strumMode));
+        json_object_set_new(rootJ, "strumOrder", json_integer(strumOrder));
+        json_object_set_new(rootJ, "strumSync", json_boolean(strumSync));
+        json_object_set_new(rootJ, "strumMs", json_real(strumMs));
+        json_object_set_new(rootJ, "strumDivision", json_integer(STRUM_DIVISIONS[strumDivisionIndex]));
+        json_object_set_new(rootJ, "trackMode", json_boolean(trackMode));
+        json_object_set_new(rootJ, "glideMs", json_real(glideMs));
+        json_object_set_new(rootJ, "numVoices", json_integer(numVoices));
+        json_object_set_new(rootJ, "clockRatio", json_integer(CLOCK_RATIOS[clockRatioIndex]));
+        json_object_set_new(rootJ, "voicingExtension", json_integer(voicingExtension));
+        json_object_set_new(rootJ, "voicingDrop", json_integer(voicingDrop));
+        if (!tuning.isStandard())
+            json_object_set_new(rootJ, "tuning", tuning.toJson());
+
+        json_object_set_new(rootJ, "seed", json_integer((json_int_t) randomizer.seed));
+        json_t* weightsJ = json_array();
+        for (int i = 0; i < NUM_QUALITIES; i++)
+            json_array_append_new(weightsJ, json_real(randomizer.qualityWeights[i]));
+        json_object_set_new(rootJ, "qualityWeights", weightsJ);
+        json_object_set_new(rootJ, "markov", json_boolean(randomizer.markov));
+
+        // Patterns after the last edited one are left out
+        int numSaved = getPatternIndex() + 1;
+        for (int i = numSaved; i < NUM_PATTERNS; i++)
+            if (!patterns[i].isDefault()) numSaved = i + 1;
+
+        json_t* patternsJ = json_array();
+        for (int i = 0; i < numSaved; i++)
+            json_array_append_new(patternsJ, json_string(patterns[i].toString().c_str()));
+        json_object_set_new(rootJ, "patterns", patternsJ);
+        json_object_set_new(rootJ, "pattern", json_integer(getPatternIndex()));
+        json_object_set_new(rootJ, "page", json_integer(page));
+        json_object_set_new(rootJ, "followPage", json_boolean(followPage));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t* rootJ) override {
+        json_t* divisionJ = json_object_get(rootJ, "controlDivision");
+        if (divisionJ) {
+            int division = json_integer_value(divisionJ);
+            for (int i = 0; i < NUM_CONTROL_DIVISIONS; i++)
+                if (CONTROL_DIVISIONS[i] == division) setControlDivision(i);
+        }
+
+        json_t* voiceLeadingJ = json_object_get(rootJ, "voiceLeading");
+        if (voiceLeadingJ) voiceLeading = json_is_true(voiceLeadingJ);
+        json_t* statsEnabledJ = json_object_get(rootJ, "statsEnabled");
+        if (statsEnabledJ) statsEnabled = json_is_true(statsEnabledJ);
+        json_t* quantizeModeJ = json_object_get(rootJ, "quantizeMode");
+        if (quantizeModeJ) quantizeMode = clamp((int)json_integer_value(quantizeModeJ), 0, NUM_QUANTIZE_MODES - 1);
+        json_t* harmonyRoleJ = json_object_get(rootJ, "harmonyRole");
+        if (harmonyRoleJ) harmonyRole = clamp((int)json_integer_value(harmonyRoleJ), 0, HarmonyBus::NUM_ROLES - 1);
+        json_t* harmonyChannelJ = json_object_get(rootJ, "harmonyChannel");
+        if (harmonyChannelJ) harmonyChannel = clamp((int)json_integer_value(harmonyChannelJ), 0, HarmonyBus::NUM_CHANNELS - 1);
+        json_t* strumModeJ = json_object_get(rootJ, "strumMode");
+        if (strumModeJ) strumMode = clamp((int)json_integer_value(strumModeJ), 0, StrumScheduler::NUM_MODES - 1);
+        json_t* strumOrderJ = json_object_get(rootJ, "strumOrder");
+        if (strumOrderJ) strumOrder = clamp((int)json_integer_value(strumOrderJ), 0, StrumScheduler::NUM_ORDERS - 1);
+        json_t* strumSyncJ = json_object_get(rootJ, "strumSync");
+        if (strumSyncJ) strumSync = json_is_true(strumSyncJ);
+        json_t* strumMsJ = json_object_get(rootJ, "strumMs");
+        if (strumMsJ) strumMs = clamp((float)json_number_value(strumMsJ), 0.f, MAX_STRUM_MS);
+        json_t* strumDivisionJ = json_object_get(rootJ, "strumDivision");
+        if (strumDivisionJ) {
+            int division = json_integer_value(strumDivisionJ);
+            for (int i = 0; i < NUM_STRUM_DIVISIONS; i++)
+                if (STRUM_DIVISIONS[i] == division) strumDivisionIndex = i;
+        }
+        json_t* trackModeJ = json_object_get(rootJ, "trackMode");
+        if (trackModeJ) trackMode = json_is_true(trackModeJ);
+        json_t* glideMsJ = json_object_get(rootJ, "glideMs");
+        if (glideMsJ) glideMs = clamp((float)json_number_value(glideMsJ), 0.f, MAX_GLIDE_MS);
+        json_t* clockRatioJ = json_object_get(rootJ, "clockRatio");
+        if (clockRatioJ) {
+            int ratio = json_integer_value(clockRatioJ);
+            for (int i = 0; i < NUM_CLOCK_RATIOS; i++)
+                if (CLOCK_RATIOS[i] == ratio) clockRatioIndex = i;
+        }
+        json_t* numVoicesJ = json_object_get(rootJ, "numVoices");
+        if (numVoicesJ) numVoices = clamp((int)json_integer_value(numVoicesJ), 1, Voicing::MAX_VOICES);
+        json_t* voicingExtensionJ = json_object_get(rootJ, "voicingExtension");
+        if (voicingExtensionJ) voicingExtension = clamp((int)json_integer_value(voicingExtensionJ), 0, Voicing::NUM_EXTENSIONS - 1);
+        json_t* voicingDropJ = json_object_get(rootJ, "voicingDrop");
+        if (voicingDropJ) voicingDrop = clamp((int)json_integer_value(voicingDropJ), 0, Voicing::NUM_DROPS - 1);
+        Tuning newTuning;
+        json_t* tuningJ = json_object_get(rootJ, "tuning");
+        if (tuningJ) newTuning.fromJson(tuningJ);
+        setTuning(newTuning);
+
+        // Reseeding on load makes the randomizations after a patch load repeatable
+        json_t* seedJ = json_object_get(rootJ, "seed");
+        if (seedJ) randomizer.setSeed((uint64_t) json_integer_value(seedJ));
+        json_t* weightsJ = json_object_get(rootJ, "qualityWeights");
+        if (weightsJ) {
+            size_t i;
+            json_t* weightJ;
+            json_array_foreach(weightsJ, i, weightJ) {
+                if ((int)i >= NUM_QUALITIES) break;
+                randomizer.qualityWeights[i] = clamp((float)json_number_value(weightJ), 0.f, 1.f);
+            }
+        }
+        json_t* markovJ = json_object_get(rootJ, "markov");
+        if (markovJ) randomizer.markov = json_is_true(markovJ);
+
+        // The whole bank is parsed here, on patch load, never on the audio thread.
+        // Patches from before the bank have no patterns and keep their knobs.
+        json_t* patternsJ = json_object_get(rootJ, "patterns");
+        if (patternsJ) {
+            for (Pattern& p : patterns)
+                p.init();
+            size_t i;
+            json_t* patternJ;
+            json_array_foreach(patternsJ, i, patternJ) {
+                if ((int)i >= NUM_PATTERNS) break;
+                if (!patterns[i].fromString(json_string_value(patternJ)))
+                    patterns[i].init();
+            }
+        }
+        json_t* pageJ = json_object_get(rootJ, "page");
+        page = pageJ ? clamp((int)json_integer_value(pageJ), 0, NUM_PAGES - 1) : 0;
+        knobPage = std::min(page, getLastPage());
+        json_t* followPageJ = json_object_get(rootJ, "followPage");
+        if (followPageJ) followPage = json_is_true(followPageJ);
+        json_t* patternJ = json_object_get(rootJ, "pattern");
+        selectPattern(patternJ ? json_integer_value(patternJ) : 0);
+    }
+
+    void process(const ProcessArgs& args) override {
+        // What depends on the sample rate is only worked out again when it changes
+        if (args.sampleRate != sampleRate) {
+            sampleRate = args.sampleRate;
+            maxClockInterval = (uint32_t)(MAX_CLOCK_SECONDS * sampleRate);
+            glideCoefficientMs = 0.f;
+        }
+        if (!statsEnabled) {
+            processSample();
+            return;
+        }
+        ProcessStats::Clock::time_point start = ProcessStats::Clock::now();
+        bool trigger = processSample();
+        stats.record(trigger, start, ProcessStats::Clock::now());
+    }
+
+    // Returns true when the sample carried a clock or reset edge.
+    bool processSample() {
+        AllocGuard::Scope allocGuard;
+
+        numLanes = std::max(inputs[CLOCK_INPUT].getChannels(), 1);
+        int clockMask = 0;
+        int resetMask = 0;
+        for (int c = 0; c < numLanes; c += 4) {
+            float_4 clock = inputs[CLOCK_INPUT].getVoltageSimd<float_4>(c);
+            float_4 reset = inputs[RESET_INPUT].getPolyVoltageSimd<float_4>(c);
+            clockMask |= simd::movemask(clockTriggers[c / 4].process(clock)) << c;
+            resetMask |= simd::movemask(resetTriggers[c / 4].process(reset)) << c;
+        }
+        // Channels past the cable's count hold stale voltages
+        clockMask &= (1 << numLanes) - 1;
+        resetMask &= (1 << numLanes) - 1;
+
+        // Clock pulses to steps, multiplied or divided. A reset restarts the
+        // division; its own step comes from resetMask.
+        int ratio = CLOCK_RATIOS[clockRatioIndex];
+        int multiply = std::max(ratio, 1);
+        int divide = std::max(-ratio, 1);
+        int triggerMask = resetMask;
+        for (int lane = 0; lane < numLanes; lane++) {
+            ClockTracker& tracker = clockTrackers[lane];
+            if (resetMask & (1 << lane)) tracker.reset();
+            if (tracker.process(clockMask & (1 << lane), multiply, divide, maxClockInterval, lane == 0))
+                triggerMask |= 1 << lane;
+        }
+        bool trigger = triggerMask != 0;
+        if (statsEnabled && trigger) {
+            ProcessStats::add(stats.clockEdges, __builtin_popcount(triggerMask));
+            ProcessStats::add(stats.resets, __builtin_popcount(resetMask));
+        }
+
+        float rndBtn = params[RANDOMIZE_BTN_PARAM].getValue();
+        float rndCv = inputs[RANDOM_CV_INPUT].getVoltage();
+        if (randomizeTrigger.process(rndBtn + rndCv)) {
+            randomizer.start(getParamIndex(STEPS_COUNT_PARAM, 1, MAX_STEPS));
+            if (statsEnabled) ProcessStats::add(stats.randomizations, 1);
+        }
+        // One step per sample; the knobs pick up the new degrees on the next control tick
+        if (randomizer.isBusy() && randomizer.process()) {
+            pattern->copySteps(randomizer.scratch, randomizer.numSteps);
+            knobsDirty = true;
+        }
+        
+        // Motorized CV and output housekeeping run at control rate. A clock or
+        // reset edge forces a tick so CV arriving with the edge is not missed;
+        // what no edge waits for (a new library, ANALYZE) keeps to the divider.
+        bool dividerTick = controlDivider.process();
+        bool controlTick = dividerTick || trigger;
+        bool keyChanged = false;
+        uint64_t chordsBefore = statsEnabled ? stats.chords.load(std::memory_order_relaxed) : 0;
+        if (controlTick) {
+            if (dividerTick) refreshLibrary();
+            processMotorizedCv();
+            // The chord this edge plays was prepared from what the leader
+            // published before it; what it publishes now is for the next edge
+            if (!trigger) followHarmony();
+
+            // A requested pattern takes over on the clock edge. Its chords were
+            // already prepared, since the key follows the requested pattern.
+            if (trigger && pattern != &patterns[requestedPattern]) {
+                pattern = &patterns[requestedPattern];
+                knobsDirty = true;
+            }
+            syncKnobs();
+
+            ChordKey key;
+            readChordKey(key);
+            keyChanged = std::memcmp(&key, &preparedKey, sizeof(key)) != 0;
+            if (keyChanged) {
+                bool libraryChanged = key.library != preparedKey.library;
+                preparedKey = key;
+                if (trackMode) trackLanes(libraryChanged);
+                // Only the lanes taking a step on this edge need their chord
+                // under the new key now; the rest wait until after the outputs
+                prepareLanes(triggerMask & ~resetMask, triggerMask & resetMask);
+            }
+        }
+
+        if (trigger) {
+            for (int mask = triggerMask; mask; mask &= mask - 1) {
+                int lane = __builtin_ctz(mask);
+                bool reset = resetMask & (1 << lane);
+                laneSteps[lane] = reset ? resetSteps[lane] : nextSteps[lane];
+                laneChords[lane] = reset ? resetChords[lane] : nextChords[lane];
+                for (int k = 0; k < 4; k++)
+                    laneVoices[k][lane] = reset ? resetVoices[k][lane] : nextVoices[k][lane];
+            }
+
+            if (triggerMask & 1) {
+                setBusNext(laneSteps[0]);
+                startStrum();
+            }
+        }
+        if (!strum.isEmpty()) processStrum();
+        else if (gatesOpening && !(triggerMask & 1)) openGates();
+        if (glideMs > 0.f) processGlide();
+
+        if (statsEnabled && trigger)
+            ProcessStats::add(stats.edgeChords, stats.chords.load(std::memory_order_relaxed) - chordsBefore);
+        if (controlTick) {
+            // Lane chords only move on an edge or with the key in track mode
+            writeOutputs(trigger || keyChanged);
+            publishBus();
+            if (inputs[QUANTIZE_INPUT].isConnected()) updateQuantizer();
+            if (dividerTick) analyzeInput();
+        }
+        if (inputs[QUANTIZE_INPUT].isConnected()) processQuantizer();
+        else if (quantizing) stopQuantizer();
+        // The outputs are already out; the following step can take its time
+        int laneMask = (1 << numLanes) - 1;
+        if (keyChanged) prepareLanes(laneMask, laneMask);
+        else if (trigger) prepareLanes(triggerMask, preparedKey.voiceLeading ? triggerMask : 0);
+        if (controlTick) leadHarmony();
+        if (snapshotDivider.process()) publishSnapshot();
+        return trigger;
+    }
+
+    void readChordKey(ChordKey& key) {
+        key.library = library;
+        // Read directly from params (Motorized values)
+        key.root = getParamIndex(ROOT_NOTE_PARAM, 0, NUM_ROOTS - 1);
+        key.scale = getParamIndex(SCALE_TYPE_PARAM, 0, library->size() - 1);
+        key.numSteps = getParamIndex(STEPS_COUNT_PARAM, 1, MAX_STEPS);
+        key.numLanes = numLanes;
+        key.openVoicing = params[SPREAD_PARAM].getValue() > 0.5f;
+        key.voiceLeading = voiceLeading;
+        // The pattern the next edge will play
+        key.pattern = requestedPattern;
+        key.revision = patterns[key.pattern].revision;
+        key.activePattern = getPatternIndex();
+        key.activeRevision = pattern->revision;
+        key.followDegree = followDegree;
+        key.followQuality = followQuality;
+    }
+
+    void setBusNext(int step, bool active = false) {
+        busNext.root = preparedKey.root;
+        busNext.scale = preparedKey.scale;
+        busNext.degree = getStepDegree(step, active);
+        busNext.quality = getStepQuality(step, active);
+        busNext.step = step;
+    }
+
+    // A knob as an index in [min, max]. Clamped while still a float, so NaN
+    // or a huge value from a malformed patch cannot make the cast undefined.
+    // Compares instead of clamp(), whose fmin and fmax are library calls;
+    // NaN still lands on max, as it would there.
+    int getParamIndex(int paramId, int min, int max) {
+        float value = params[paramId].getValue();
+        if (!(value < (float)max)) return max;
+        return (value > (float)min) ? (int)value : min;
+    }
+
+    // What a step of the prepared key plays: in the pattern the next edge
+    // plays, or with `active` in the one playing now
+    int getStepDegree(int step, bool active = false) const {
+        const ChordKey& key = preparedKey;
+        return (key.followDegree >= 0) ? key.followDegree : patterns[active ? key.activePattern : key.pattern].degrees[step];
+    }
+
+    int getStepQuality(int step, bool active = false) const {
+        const ChordKey& key = preparedKey;
+        return (key.followDegree >= 0) ? key.followQuality : patterns[active ? key.activePattern : key.pattern].qualities[step];
+    }
+
+    int getLastPage() {
+        int numSteps = getParamIndex(STEPS_COUNT_PARAM, 1, MAX_STEPS);
+        return (numSteps - 1) / PAGE_SIZE;
+    }
+
+    // A knob the user moved is stored in the active pattern; otherwise the
+    // knob follows the pattern, after a switch or a randomize. Unless one of
+    // those happened or a knob moved, one sum of the sixteen knobs' distances
+    // from their last values, which a move or a NaN leaves above zero.
+    void syncKnobs() {
+        if (followPage) page = laneSteps[0] / PAGE_SIZE;
+        int newPage = std::min(page, getLastPage());
+        if (newPage != knobPage) {
+            knobPage = newPage;
+            knobsDirty = true;
+        }
+        float moved = 0.f;
+        for (int i = 0; i < PAGE_SIZE; i++)
+            moved += std::fabs(params[STEP_DEGREE_PARAM_0 + i].getValue() - knobValues[i]);
+        if (moved == 0.f && !knobsDirty) return;
+        knobsDirty = false;
+
+        uint8_t* degrees = pattern->degrees + knobPage * PAGE_SIZE;
+        for (int i = 0; i < PAGE_SIZE; i++) {
+            int knob = getParamIndex(STEP_DEGREE_PARAM_0 + i, 0, NUM_DEGREES - 1);
+            if (knob != knobDegrees[i]) {
+                degrees[i] = (uint8_t)knob;
+                pattern->revision++;
+            }
+            else if (knob != degrees[i]) {
+                params[STEP_DEGREE_PARAM_0 + i].setValue((float)degrees[i]);
+            }
+            knobDegrees[i] = degrees[i];
+            knobValues[i] = params[STEP_DEGREE_PARAM_0 + i].getValue();
+        }
+    }
+
+    // Recomputes the next chord of the lanes in nextMask and the reset chord
+    // of those in resetMask, from preparedKey and each lane's current voices.
+    // Without voice leading the reset chord is the same for every lane and
+    // only changes with the key.
+    void prepareLanes(int nextMask, int resetMask) {
+        const ChordKey& key = preparedKey;
+        for (int mask = nextMask; mask; mask &= mask - 1) {
+            int lane = __builtin_ctz(mask);
+            int step = laneSteps[lane] + 1;
+            nextSteps[lane] = (step < key.numSteps) ? step : 0;
+            prepareChord(lane, nextSteps[lane], nextVoices, nextChords);
+        }
+        int resetStep = 1 % key.numSteps;
+        for (int mask = resetMask; mask; mask &= mask - 1) {
+            int lane = __builtin_ctz(mask);
+            resetSteps[lane] = resetStep;
+            prepareChord(lane, resetStep, resetVoices, resetChords);
+        }
+    }
+
+    // Track mode: a lane whose current step sounds different under the new
+    // key plays it again at once. With voice leading that is led from the
+    // chord it replaces, so a root sweep moves each voice by the smallest
+    // interval. The step is read from the active pattern; a requested one
+    // only sounds from the next edge. Key changes that leave the chord alone
+    // (STEPS, another step's knob, a page, the voicing options) do not touch
+    // the lane, and voices a strum has not reached yet keep their note-on,
+    // which takes the new pitch when it is due.
+    void trackLanes(bool libraryChanged) {
+        int changed = 0;
+        for (int lane = 0; lane < numLanes; lane++) {
+            int step = laneSteps[lane];
+            int32_t id = getChordId(getStepDegree(step, true), getStepQuality(step, true));
+            if (!libraryChanged && id == laneChords[lane]) continue;
+            prepareChord(lane, step, laneVoices, laneChords, true);
+            changed |= 1 << lane;
+        }
+        if (!(changed & 1)) return;
+        setBusNext(laneSteps[0], true);
+        float chord[4];
+        for (int k = 0; k < 4; k++)
+            chord[k] = laneVoices[k][0];
+        int pending = strum.getPendingVoices();
+        for (int k = 0; k < 4; k++)
+            if (!(pending & (1 << k))) playing[k] = chord[k];
+        strum.retune(chord);
+        updateVoicing();
+    }
+
+    // A chord of the prepared key's scale and root, as one number
+    int32_t getChordId(int degree, int quality) const {
+        const ChordKey& key = preparedKey;
+        return ((key.scale * NUM_DEGREES + degree) * NUM_QUALITIES + quality) * NUM_ROOTS + key.root;
+    }
+
+    void prepareChord(int lane, int step, float voices[4][MAX_LANES], int32_t chords[MAX_LANES], bool active = false) {
+        const ChordKey& key = preparedKey;
+        if (statsEnabled) ProcessStats::add(stats.chords, 1);
+        int degree = getStepDegree(step, active);
+        int quality = getStepQuality(step, active);
+        const ChordEntry& chord = library->getChord(key.scale, degree, quality);
+        chords[lane] = getChordId(degree, quality);
+        float rootV = library->rootVoltages[key.root];
+        float target[4];
+        for (int k = 0; k < 4; k++)
+            target[k] = rootV + chord.voltages[k];
+
+        if (key.voiceLeading) {
+            float prev[4] = {laneVoices[0][lane], laneVoices[1][lane], laneVoices[2][lane], laneVoices[3][lane]};
+            float led[4];
+            VoiceLeading::lead(prev, target, key.openVoicing, led);
+            std::copy(led, led + 4, target);
+        }
+        for (int k = 0; k < 4; k++)
+            voices[k][lane] = target[k];
+    }
+
+    // --- ABSOLUTE CV CONTROL (Motorized Knobs) ---
+    // Params are only written when the quantized CV value actually changes.
+    // Picks up a reloaded scale library or a new tuning (three atomic loads
+    // and a store when nothing changed). The mark lets the old one be freed.
+    void refreshLibrary() {
+        uint32_t epoch = ScaleLibrary::getEpoch();
+        const ScaleLibrary* latest = getLibrary();
+        // The SCALE knob's range is the UI's to update; readers clamp the
+        // knob to the new list meanwhile
+        if (latest != library) library = latest;
+        libraryReader.mark(epoch);
+    }
+
+    void processMotorizedCv() {
+        // 1. Steps (1V = Step 1, 16V = Step 16). Kept at 1V per step so older
+        // patches play the same; 256 steps over Rack's 10V would be 39mV each,
+        // too fine for a sequencer's CV. Longer sequences are set with the knob.
+        if (inputs[STEPS_CV_INPUT].isConnected()) {
+            float stepsCv = inputs[STEPS_CV_INPUT].getVoltage();
+            if (stepsCvQuantizer.process(clamp(stepsCv, 1.f, 16.f)))
+                params[STEPS_COUNT_PARAM].setValue((float)stepsCvQuantizer.value);
+        }
+        else stepsCvQuantizer.reset();
+
+        // 2. Spread (0V = 0%, 10V = 100%, in 1% steps). Each step is set to
+        // its middle, so the 5V boundary between steps 49 and 50 is where
+        // the voicing opens, with the hysteresis band either side of it.
+        if (inputs[SPREAD_CV_INPUT].isConnected()) {
+            float spreadCv = inputs[SPREAD_CV_INPUT].getVoltage();
+            if (spreadCvQuantizer.process(clamp(spreadCv / 10.f, 0.f, 1.f) * 100.f))
+                params[SPREAD_PARAM].setValue(std::min((spreadCvQuantizer.value + 0.5f) / 100.f, 1.f));
+        }
+        else spreadCvQuantizer.reset();
+
+        // 3. Root (1V/Octave standard: 0V=0, 5V=60)
+        if (inputs[ROOT_CV_INPUT].isConnected()) {
+            float rootCv = inputs[ROOT_CV_INPUT].getVoltage();
+            if (rootCvQuantizer.process(clamp(rootCv * 12.f, 0.f, 60.f)))
+                params[ROOT_NOTE_PARAM].setValue((float)rootCvQuantizer.value);
+        }
+        else rootCvQuantizer.reset();
+
+        // 4. Scale (Map 0-10V to Full Scale List)
+        if (inputs[SCALE_CV_INPUT].isConnected()) {
+            float scaleCv = inputs[SCALE_CV_INPUT].getVoltage();
+            float maxScale = (float)(library->size() - 1);
+            // Map 0V-10V -> 0-MaxScale
+            float mappedVal = (scaleCv / 10.f) * maxScale;
+            if (scaleCvQuantizer.process(clamp(mappedVal, 0.f, maxScale)))
+                params[SCALE_TYPE_PARAM].setValue((float)scaleCvQuantizer.value);
+        }
+        else scaleCvQuantizer.reset();
+
+        // 5. Pattern (Map 0-10V to the 64 patterns)
+        if (inputs[PATTERN_CV_INPUT].isConnected()) {
+            float patternCv = inputs[PATTERN_CV_INPUT].getVoltage();
+            float maxPattern = (float)(NUM_PATTERNS - 1);
+            if (patternCvQuantizer.process(clamp(patternCv / 10.f * maxPattern, 0.f, maxPattern)))
+                requestedPattern = patternCvQuantizer.value;
+        }
+        else patternCvQuantizer.reset();
+    }
+
+    // --- HARMONY BUS ---
+    // Leader: publishes the chord lane 0 has prepared for its next edge
+    // whenever it changed, so followers have it prepared for the same edge.
+    // Claiming is retried every control tick while another leader holds the
+    // channel.
+    void leadHarmony() {
+        int wanted = (harmonyRole == HarmonyBus::ROLE_LEADER) ? harmonyChannel : -1;
+        if (wanted != claimedChannel) {
+            if (claimedChannel >= 0) HarmonyBus::release(claimedChannel, this);
+            claimedChannel = (wanted >= 0 && HarmonyBus::claim(wanted, this)) ? wanted : -1;
+            harmonyPublished = false;
+        }
+        if (claimedChannel < 0) return;
+
+        HarmonyState state;
+        state.root = preparedKey.root;
+        state.scale = preparedKey.scale;
+        state.degree = getStepDegree(nextSteps[0]);
+        state.quality = getStepQuality(nextSteps[0]);
+        if (harmonyPublished && std::memcmp(&state, &harmonyState, sizeof(state)) == 0) return;
+        harmonyState = state;
+        harmonyPublished = true;
+        HarmonyBus::channels[claimedChannel].slot.write(state);
+    }
+
+    // Follower: copies the slot only when its sequence moved. Root and scale
+    // move the knobs, like their CV inputs; the leader's chord replaces the
+    // pattern's until the module stops following.
+    void followHarmony() {
+        if (harmonyRole != HarmonyBus::ROLE_FOLLOWER) {
+            followedChannel = -1;
+            followDegree = -1;
+            return;
+        }
+        const HarmonyBus::Channel& channel = HarmonyBus::channels[harmonyChannel];
+        uint32_t sequence = channel.slot.getSequence();
+        if (harmonyChannel == followedChannel && sequence == followedSequence) return;
+        // Sequence 0: no leader has written to this channel yet
+        HarmonyState state;
+        if (sequence == 0 || !channel.slot.tryRead(state)) return;
+
+        followedChannel = harmonyChannel;
+        followedSequence = sequence;
+        params[ROOT_NOTE_PARAM].setValue((float)clamp(state.root, 0, NUM_ROOTS - 1));
+        params[SCALE_TYPE_PARAM].setValue((float)clamp(state.scale, 0, library->size() - 1));
+        followDegree = clamp(state.degree, 0, NUM_DEGREES - 1);
+        followQuality = clamp(state.quality, 0, NUM_QUALITIES - 1);
+    }
+
+    // --- STRUM / ARPEGGIO ---
+    // Lane 0 moved to a new chord. What is left of the previous one lands at
+    // once and every gate closes for this sample, so the new notes retrigger.
+    void startStrum() {
+        StrumEvent e;
+        while (strum.popAny(e))
+            if (e.gate) playing[e.voice] = e.voltage;
+        for (int k = 0; k < 4; k++)
+            setGate(k, false);
+
+        float chord[4];
+        for (int k = 0; k < 4; k++)
+            chord[k] = laneVoices[k][0];
+        updateVoicing();
+        // Unstrummed voices change on the edge; only their gates wait a sample
+        if (strumMode == StrumScheduler::MODE_OFF) {
+            std::copy(chord, chord + 4, playing);
+            gatesOpening = true;
+            return;
+        }
+        gatesOpening = false;
+        strum.schedule(chord, sampleTime + 1, getStrumSpacing(), strumMode, strumOrder);
+    }
+
+    // Samples per step of lane 0 at the clock ratio, 0 while the tempo is unknown
+    uint32_t getStepPeriod() const {
+        int ratio = CLOCK_RATIOS[clockRatioIndex];
+        uint32_t period = clockTrackers[0].period;
+        return (ratio > 0) ? period / ratio : period * -ratio;
+    }
+
+    uint32_t getStrumSpacing() const {
+        uint32_t stepPeriod = getStepPeriod();
+        if (strumSync && stepPeriod > 0) return stepPeriod / STRUM_DIVISIONS[strumDivisionIndex];
+        return (uint32_t)(strumMs * 0.001f * sampleRate);
+    }
+
+    // Every sample while events are pending: one comparison unless one is due.
+    // Otherwise process() skips it.
+    void processStrum() {
+        StrumEvent e;
+        while (strum.pop(sampleTime, e)) {
+            if (e.gate) {
+                playing[e.voice] = e.voltage;
+                writeVoice(e.voice);
+            }
+            setGate(e.voice, e.gate);
+        }
+        sampleTime++;
+    }
+
+    void openGates() {
+        for (int k = 0; k < 4; k++)
+            setGate(k, true);
+        gatesOpening = false;
+    }
+
+    void setGate(int voice, bool gate) {
+        outputs[GATE_1_OUTPUT + voice].setVoltage(gate ? 10.f : 0.f);
+        lights[VOICE_LIGHT_1 + voice].setBrightness(gate ? 1.f : 0.f);
+    }
+
+    float getSpreadOffset(int voice) {
+        // Spread is already set by CV above. Open above the middle, NaN
+        // included, as it was after clamp() to [0, 1].
+        bool open = !(params[SPREAD_PARAM].getValue() <= 0.5f);
+        return (voice == 0 && open) ? -1.0f : 0.0f;
+    }
+
+    // Lane 0's new chord, from the bus message already set for it
+    void updateVoicing() {
+        float chord[4];
+        for (int k = 0; k < 4; k++)
+            chord[k] = laneVoices[k][0];
+        int voices = clamp(numVoices, 1, Voicing::MAX_VOICES);
+        if (voices > 4 || voicingDrop != Voicing::DROP_NONE) {
+            int scale = clamp(busNext.scale, 0, library->size() - 1);
+            float rootVoltage = library->rootVoltages[clamp(busNext.root, 0, NUM_ROOTS - 1)];
+            Voicing::build(*library, scale, busNext.degree, rootVoltage, chord, voices, voicingExtension, voicingDrop, voicing);
+        }
+        // Up to four voices, undropped, are the chord as it is
+        else std::copy(chord, chord + 4, voicing);
+        for (int k = 0; k < 4; k++)
+            voicingShifts[k] = (k < voices) ? voicing[k] - chord[k] : 0.f;
+        builtVoicing[0] = numVoices;
+        builtVoicing[1] = voicingExtension;
+        builtVoicing[2] = voicingDrop;
+    }
+
+    // One voice after a strum event
+    void writeVoice(int i) {
+        // processGlide() writes these every sample while gliding
+        if (glideMs > 0.f) return;
+        float v = playing[i] + getSpreadOffset(i);
+        outputs[POLY_OUTPUT].setVoltage(v + voicingShifts[i], i);
+        outputs[VOICE_1_OUTPUT + i].setVoltage(v);
+    }
+
+    void writeOutputs(bool lanesMoved) {
+        if (numVoices != builtVoicing[0] || voicingExtension != builtVoicing[1] || voicingDrop != builtVoicing[2])
+            updateVoicing();
+        Output& poly = outputs[POLY_OUTPUT];
+        poly.setChannels(clamp(numVoices, 1, Voicing::MAX_VOICES));
+        float_4 offsets = float_4(getSpreadOffset(0), 0.f, 0.f, 0.f);
+        bool spreadMoved = offsets[0] != spreadOffsets[0];
+        spreadOffsets = offsets;
+        float_4 voices = float_4::load(playing) + spreadOffsets;
+        if (glideMs > 0.f) {
+            if (glideMs != glideCoefficientMs) {
+                glideCoefficient = 1.f - std::exp(-1000.f / (glideMs * sampleRate));
+                glideCoefficientMs = glideMs;
+            }
+        }
+        else {
+            glideVoltages = voices;   // So a glide starts where the voices are
+            poly.setVoltageSimd(voices + float_4::load(voicingShifts), 0);
+            for (int i = 0; i < 4; i++)
+                outputs[VOICE_1_OUTPUT + i].setVoltage(voices[i]);
+        }
+        for (int c = 4; c < numVoices; c += 4)
+            poly.setVoltageSimd(float_4::load(&voicing[c]), c);
+        writeLaneOutputs(lanesMoved || spreadMoved);
+    }
+
+    // LANE VOICE 1-4 only change with the lanes' chords, SPREAD, the lane
+    // count or their cables. A tick with none of those leaves them alone.
+    void writeLaneOutputs(bool moved) {
+        int patched = 0;
+        for (int i = 0; i < 4; i++)
+            patched |= outputs[LANE_VOICE_1_OUTPUT + i].isConnected() << i;
+        if (!moved && patched == laneOutputsPatched && numLanes == laneOutputsLanes) return;
+        laneOutputsPatched = patched;
+        laneOutputsLanes = numLanes;
+
+        for (int i = 0; i < 4; i++) {
+            float offset = spreadOffsets[i];
+            Output& laneOutput = outputs[LANE_VOICE_1_OUTPUT + i];
+            if (!laneOutput.isConnected()) continue;
+            laneOutput.setChannels(numLanes);
+            for (int c = 0; c < numLanes; c += 4)
+                laneOutput.setVoltageSimd(float_4::load(&laneVoices[i][c]) + offset, c);
+        }
+    }
+
+    void processGlide() {
+        float_4 target = float_4::load(playing) + spreadOffsets;
+        float_4 delta = target - glideVoltages;
+        // Lands exactly once within 0.1 mV instead of approaching forever
+        glideVoltages = simd::ifelse(simd::fabs(delta) < 1e-4f, target, glideVoltages + delta * glideCoefficient);
+        outputs[POLY_OUTPUT].setVoltageSimd(glideVoltages + float_4::load(voicingShifts), 0);
+        for (int k = 0; k < 4; k++)
+            outputs[VOICE_1_OUTPUT + k].setVoltage(glideVoltages[k]);
+    }
+
+    void updateQuantizer() {
+        uint16_t mask = 0;
+        if (quantizeMode == QUANTIZE_SCALE) {
+            mask = Quantizer::transpose(library->scales[preparedKey.scale].mask, preparedKey.root);
+        }
+        else {
+            for (int k = 0; k < 4; k++)
+                mask |= 1 << eucMod((int)std::round(laneVoices[k][0] * 12.f), 12);
+        }
+        quantizer.setMask(mask);
+    }
+
+    // Names the chord on the ANALYZE input, lowest note as the bass
+    void analyzeInput() {
+        Input& in = inputs[ANALYZE_INPUT];
+        if (!in.isConnected()) {
+            analyzedChord = ChordInfo::none();
+            return;
+        }
+        uint16_t set = 0;
+        float bass = INFINITY;
+        for (int c = 0; c < in.getChannels(); c++) {
+            // Within Rack's range before the note number cast
+            float v = clamp(in.getVoltage(c), -12.f, 12.f);
+            set |= 1 << eucMod((int)std::round(v * 12.f), 12);
+            bass = std::min(bass, v);
+        }
+        analyzedChord = ChordRecognizer::recognizeWithBass(set, (int)std::round(bass * 12.f));
+    }
+
+    // All channels every sample, four at a time, while QNT in is patched
+    void processQuantizer() {
+        Input& in = inputs[QUANTIZE_INPUT];
+        Output& out = outputs[QUANTIZE_OUTPUT];
+        // The mask is only kept up to date while QNT in is patched
+        if (!quantizing) updateQuantizer();
+        quantizing = true;
+        if (!out.isConnected()) return;
+        int channels = in.getChannels();
+        out.setChannels(channels);
+        for (int c = 0; c < channels; c += 4)
+            out.setVoltageSimd(quantizer.process(in.getVoltageSimd<float_4>(c)), c);
+    }
+
+    // QNT in unpatched: QNT out drops to 0V once, then costs one branch
+    void stopQuantizer() {
+        outputs[QUANTIZE_OUTPUT].setChannels(0);
+        quantizing = false;
+    }
+
+    // Writes the producer buffer and asks Rack to flip it in at the end of
+    // the sample. Only on change, so readers can rely on the counter.
+    void publishBus() {
+        for (int k = 0; k < 4; k++)
+            busNext.voltages[k] = outputs[VOICE_1_OUTPUT + k].getVoltage();
+        busNext.counter = bus.counter;
+        if (std::memcmp(&busNext, &bus, sizeof(bus)) == 0) return;
+
+        busNext.counter++;
+        bus = busNext;
+        *(ChordBus::Message*) rightExpander.producerMessage = bus;
+        rightExpander.requestMessageFlip();
+    }
+
+    void publishSnapshot(bool force = false) {
+        UiSnapshot s;
+        std::memset(&s, 0, sizeof(s));
+        s.activeStep = laneSteps[0];
+        s.root = getParamIndex(ROOT_NOTE_PARAM, 0, NUM_ROOTS - 1);
+        s.scale = getParamIndex(SCALE_TYPE_PARAM, 0, library->size() - 1);
+        s.numSteps = getParamIndex(STEPS_COUNT_PARAM, 1, MAX_STEPS);
+        s.page = knobPage;
+        std::memcpy(s.degrees, pattern->degrees + knobPage * PAGE_SIZE, sizeof(s.degrees));
+        std::memcpy(s.qualities, pattern->qualities + knobPage * PAGE_SIZE, sizeof(s.qualities));
+        if (followDegree >= 0) {
+            std::memset(s.degrees, followDegree, sizeof(s.degrees));
+            std::memset(s.qualities, followQuality, sizeof(s.qualities));
+        }
+        for (int k = 0; k < 4; k++)
+            s.voltages[k] = outputs[VOICE_1_OUTPUT + k].getVoltage();
+        s.analyzed = analyzedChord;
+
+        publishOverview(s.numSteps, force);
+        if (!force && std::memcmp(&s, &lastSnapshot, sizeof(s)) == 0) return;
+        lastSnapshot = s;
+        uiSnapshot.write(s);
+    }
+
+    // Costs four compares unless the sequence changed.
+    void publishOverview(int numSteps, bool force) {
+        uint32_t key[4] = {(uint32_t) getPatternIndex(), pattern->revision, (uint32_t) numSteps, (uint32_t) knobPage};
+        if (!force && std::memcmp(key, overviewKey, sizeof(key)) == 0) return;
+        std::memcpy(overviewKey, key, sizeof(key));
+
+        OverviewSnapshot o;
+        o.pattern = key[0];
+        o.revision = key[1];
+        o.numSteps = numSteps;
+        o.page = knobPage;
+        std::memcpy(o.degrees, pattern->degrees, sizeof(o.degrees));
+        std::memcpy(o.qualities, pattern->qualities, sizeof(o.qualities));
+        overviewSnapshot.write(o);
+    }
+};
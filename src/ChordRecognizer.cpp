@@ -0,0 +1,110 @@
+#include "ChordRecognizer.hpp"
+#include "ScaleLibrary.hpp"
+
+static constexpr uint16_t intervals(int a, int b = -1, int c = -1, int d = -1, int e = -1) {
+    return (1 << a) | (b < 0 ? 0 : 1 << b) | (c < 0 ? 0 : 1 << c) | (d < 0 ? 0 : 1 << d) | (e < 0 ? 0 : 1 << e);
+}
+
+const ChordRecognizer::Shape ChordRecognizer::SHAPES[] = {
+    // Triads
+    {"", intervals(0, 4, 7)},
+    {"m", intervals(0, 3, 7)},
+    {"dim", intervals(0, 3, 6)},
+    {"aug", intervals(0, 4, 8)},
+    {"sus4", intervals(0, 5, 7)},
+    {"sus2", intervals(0, 2, 7)},
+    {"b5", intervals(0, 4, 6)},
+    // Sevenths and sixths
+    {"7", intervals(0, 4, 7, 10)},
+    {"maj7", intervals(0, 4, 7, 11)},
+    {"m7", intervals(0, 3, 7, 10)},
+    {"6", intervals(0, 4, 7, 9)},
+    {"m6", intervals(0, 3, 7, 9)},
+    {"m7b5", intervals(0, 3, 6, 10)},
+    {"dim7", intervals(0, 3, 6, 9)},
+    {"mMaj7", intervals(0, 3, 7, 11)},
+    {"7sus4", intervals(0, 5, 7, 10)},
+    {"7#5", intervals(0, 4, 8, 10)},
+    {"maj7#5", intervals(0, 4, 8, 11)},
+    {"7b5", intervals(0, 4, 6, 10)},
+    // Added tones and ninths
+    {"add9", intervals(0, 2, 4, 7)},
+    {"madd9", intervals(0, 2, 3, 7)},
+    {"9", intervals(0, 2, 4, 7, 10)},
+    {"maj9", intervals(0, 2, 4, 7, 11)},
+    {"m9", intervals(0, 2, 3, 7, 10)},
+    {"6/9", intervals(0, 2, 4, 7, 9)},
+    // Without fifth
+    {"7", intervals(0, 4, 10)},
+    {"maj7", intervals(0, 4, 11)},
+    {"m7", intervals(0, 3, 10)},
+    {"5", intervals(0, 7)},
+    {"", intervals(0)},
+};
+const int ChordRecognizer::NUM_SHAPES = sizeof(SHAPES) / sizeof(SHAPES[0]);
+
+ChordInfo ChordRecognizer::TABLE[4096][12];
+uint8_t ChordRecognizer::BEST_ROOT[4096];
+
+// Interval names for notes outside the chord shape
+static const char* const EXTENSION_NAMES[12] = {"", "b9", "9", "#9", "3", "11", "#11", "5", "b13", "13", "7", "maj7"};
+
+std::string ChordRecognizer::getName(ChordInfo info) {
+    if (!info.isValid()) return "";
+    std::string name = std::string(NOTE_NAMES[info.root]) + SHAPES[info.shape].suffix;
+    if (info.extensions) {
+        name += "(";
+        bool first = true;
+        for (int i = 1; i < 12; i++) {
+            if (!(info.extensions & (1 << i))) continue;
+            if (!first) name += ",";
+            name += EXTENSION_NAMES[i];
+            first = false;
+        }
+        name += ")";
+    }
+    return name;
+}
+
+void ChordRecognizer::build() {
+    for (int set = 0; set < 4096; set++) {
+        int bestRoot = 0;
+        int bestExtensions = 13;
+        int bestShape = NUM_SHAPES;
+        for (int root = 0; root < 12; root++) {
+            ChordInfo& info = TABLE[set][root];
+            info.root = root;
+            info.shape = ChordInfo::NO_CHORD;
+            info.extensions = 0;
+            if (!(set & (1 << root))) continue;
+
+            // The set seen from the root
+            uint16_t relative = ((set >> root) | (set << (12 - root))) & 0xfff;
+            int bestSize = 0;
+            for (int q = 0; q < NUM_SHAPES; q++) {
+                uint16_t shape = SHAPES[q].intervals;
+                int size = __builtin_popcount(shape);
+                if ((shape & ~relative) || size <= bestSize) continue;
+                info.shape = q;
+                info.extensions = relative & ~shape;
+                bestSize = size;
+            }
+
+            // Fewest unexplained notes wins, then the preferred shape
+            int extensions = __builtin_popcount(info.extensions);
+            if (extensions < bestExtensions || (extensions == bestExtensions && info.shape < bestShape)) {
+                bestRoot = root;
+                bestExtensions = extensions;
+                bestShape = info.shape;
+            }
+        }
+        BEST_ROOT[set] = bestRoot;
+    }
+}
+
+// Filled while the plugin library loads, long before any audio thread runs.
+static struct TableBuilder {
+    TableBuilder() {
+        ChordRecognizer::build();
+    }
+} tableBuilder;
@@ -0,0 +1,68 @@
+#pragma once
+#include "plugin.hpp"
+
+/**
+ * ChordRecognizer.hpp
+ * Names any set of pitch classes. Every 12-bit set (bit n = pitch class n,
+ * C = 0) is analysed against every root once, at library load, so naming a
+ * chord at run time is a table lookup that returns plain integers; strings
+ * are only built by getName(), for drawing.
+ */
+
+// A recognized chord: the largest known chord shape on `root` contained in
+// the set, plus the set's other notes as `extensions` (intervals above root).
+struct ChordInfo {
+    uint16_t extensions;
+    uint8_t shape;      // Index into ChordRecognizer::SHAPES, or NO_CHORD
+    uint8_t root;       // Pitch class
+
+    static const uint8_t NO_CHORD = 0xff;
+
+    static ChordInfo none() {
+        ChordInfo info = {0, NO_CHORD, 0};
+        return info;
+    }
+
+    bool isValid() const {
+        return shape != NO_CHORD;
+    }
+};
+
+struct ChordRecognizer {
+    struct Shape {
+        const char* suffix;
+        uint16_t intervals;   // Bit n = n semitones above the root
+    };
+
+    // In order of preference when two shapes explain the same notes
+    static const Shape SHAPES[];
+    static const int NUM_SHAPES;
+
+    // [set][root]; NO_CHORD when root is not in the set
+    static ChordInfo TABLE[4096][12];
+    // The most plausible root for each set, for chords of unknown function
+    static uint8_t BEST_ROOT[4096];
+
+    // Names the set as a chord on a known root, e.g. a scale degree.
+    static ChordInfo recognize(uint16_t set, int root) {
+        return TABLE[set & 0xfff][eucMod(root, 12)];
+    }
+
+    // Names the set with no known root. The bass note is taken as the root if
+    // it spells a chord without extensions, otherwise the best-fitting root.
+    static ChordInfo recognize(uint16_t set) {
+        set &= 0xfff;
+        return TABLE[set][BEST_ROOT[set]];
+    }
+
+    static ChordInfo recognizeWithBass(uint16_t set, int bass) {
+        ChordInfo info = recognize(set, bass);
+        if (info.isValid() && info.extensions == 0) return info;
+        return recognize(set);
+    }
+
+    // "C#m7", "G7(b9)". UI thread only.
+    static std::string getName(ChordInfo info);
+
+    static void build();
+};
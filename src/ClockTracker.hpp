@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * ClockTracker.hpp
+ * Follows the tempo of one clock lane and turns its edges into step ticks.
+ * The period is the median of the last 7 edge intervals, so one missed or
+ * doubled edge does not move it, and jitter the median distance of the
+ * intervals from it, taken only when asked for. Multiplying places the extra
+ * ticks at even fractions of the period after each edge, dividing passes
+ * every Nth edge. Fixed state, one compare per sample between edges; the
+ * median is only taken on an edge that changed the intervals.
+ */
+struct ClockTracker {
+    static const int HISTORY = 7;
+
+    uint32_t intervals[HISTORY] = {};
+    int numIntervals = 0;
+    int nextInterval = 0;
+    uint32_t sinceEdge = UINT32_MAX;   // Samples, saturating
+    uint32_t period = 0;     // Median interval in samples, 0 while unknown
+    bool periodStale = false;   // The intervals changed since it was taken
+
+    int edgeCount = 0;       // Edges since the last divided tick
+    int ticksLeft = 0;       // Multiplied ticks still due before the next edge
+    uint32_t nextTick = 0;   // sinceEdge of the next one
+
+    // Restarts division and drops pending multiplied ticks; the tempo stays.
+    void reset() {
+        edgeCount = 0;
+        ticksLeft = 0;
+    }
+
+    // One sample. An interval over maxInterval samples (a stopped clock)
+    // starts the history afresh. `estimate`: update `period` on this edge,
+    // which multiplying does regardless. Returns true when the lane steps.
+    bool process(bool edge, int multiply, int divide, uint32_t maxInterval, bool estimate) {
+        if (sinceEdge != UINT32_MAX) sinceEdge++;
+        if (!edge) {
+            if (ticksLeft == 0 || sinceEdge < nextTick) return false;
+            ticksLeft--;
+            nextTick = (uint32_t)((uint64_t)period * (multiply - ticksLeft) / multiply);
+            return true;
+        }
+
+        addInterval(maxInterval, estimate || multiply > 1);
+        ticksLeft = (multiply > 1 && period > 0) ? multiply - 1 : 0;
+        nextTick = period / std::max(multiply, 1);
+        bool tick = (edgeCount == 0);
+        edgeCount = (edgeCount + 1 < divide) ? edgeCount + 1 : 0;
+        return tick;
+    }
+
+    void addInterval(uint32_t maxInterval, bool estimate) {
+        if (sinceEdge > maxInterval) {
+            // The median reads intervals[0] onwards, so refill from there
+            numIntervals = 0;
+            nextInterval = 0;
+            periodStale = true;
+        }
+        else {
+            // A steady clock mostly replaces an interval with an equal one,
+            // which leaves the median where it was
+            if (numIntervals < HISTORY || intervals[nextInterval] != sinceEdge) periodStale = true;
+            intervals[nextInterval] = sinceEdge;
+            nextInterval = (nextInterval + 1) % HISTORY;
+            if (numIntervals < HISTORY) numIntervals++;
+        }
+        sinceEdge = 0;
+        if (!estimate || !periodStale) return;
+        period = (numIntervals > 0) ? getMedian(intervals, numIntervals) : 0;
+        periodStale = false;
+    }
+
+    // Median distance of the intervals from the period, for display. Not on
+    // the edge: nothing the audio thread does depends on it.
+    uint32_t getJitter() const {
+        if (numIntervals == 0) return 0;
+        uint32_t deviations[HISTORY];
+        for (int i = 0; i < numIntervals; i++)
+            deviations[i] = (intervals[i] > period) ? intervals[i] - period : period - intervals[i];
+        return getMedian(deviations, numIntervals);
+    }
+
+    static uint32_t getMedian(const uint32_t* values, int n) {
+        uint32_t sorted[HISTORY] = {};
+        for (int i = 0; i < n; i++) {
+            int j = i;
+            for (; j > 0 && sorted[j - 1] > values[i]; j--)
+                sorted[j] = sorted[j - 1];
+            sorted[j] = values[i];
+        }
+        return sorted[n / 2];
+    }
+};
@@ -0,0 +1,5 @@
+#include "HarmonyBus.hpp"
+
+const char* const HarmonyBus::CHANNEL_NAMES[NUM_CHANNELS] = {"A", "B", "C", "D", "E", "F", "G", "H"};
+
+HarmonyBus::Channel HarmonyBus::channels[NUM_CHANNELS];
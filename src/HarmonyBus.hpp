@@ -0,0 +1,58 @@
+#pragma once
+#include "SeqLock.hpp"
+#include <atomic>
+#include <cstdint>
+
+/**
+ * HarmonyBus.hpp
+ * Process-wide channels that carry one leader's harmony to any number of
+ * followers, without cables. Every channel is a statically allocated seqlock
+ * slot, so instances can come and go while audio runs without allocating or
+ * locking: a leader claims a channel with one compare-exchange and is its
+ * only writer until it lets go, and followers only copy the slot when its
+ * sequence number moved.
+ */
+struct HarmonyState {
+    int32_t root;     // ROOT knob, 0-60
+    int32_t scale;    // Index in the scale list
+    int32_t degree;   // Scale degree of the chord root, 0-6
+    int32_t quality;  // Fourth voice, QUALITY_EXTENSIONS order
+};
+
+struct HarmonyBus {
+    static const int NUM_CHANNELS = 8;
+    static const char* const CHANNEL_NAMES[NUM_CHANNELS];
+
+    enum Role {
+        ROLE_OFF,
+        ROLE_LEADER,
+        ROLE_FOLLOWER,
+        NUM_ROLES
+    };
+
+    struct Channel {
+        SeqLock<HarmonyState> slot;
+        std::atomic<const void*> leader;
+
+        Channel() : leader(nullptr) {}
+    };
+
+    static Channel channels[NUM_CHANNELS];
+
+    // Called by the thread that will write the slot. Fails while another
+    // leader holds the channel.
+    static bool claim(int channel, const void* owner) {
+        const void* expected = nullptr;
+        return channels[channel].leader.compare_exchange_strong(expected, owner, std::memory_order_acq_rel);
+    }
+
+    // Also called by the writing thread, or once it can no longer write.
+    static void release(int channel, const void* owner) {
+        const void* expected = owner;
+        channels[channel].leader.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+    }
+
+    static bool hasLeader(int channel) {
+        return channels[channel].leader.load(std::memory_order_acquire) != nullptr;
+    }
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include "plugin.hpp"
+#include <atomic>
+#include <chrono>
+
+/**
+ * ProcessStats.hpp
+ * Opt-in counters of what one module instance costs on the audio thread.
+ * Written only by the audio thread with relaxed loads and stores (no locked
+ * instructions); the UI reads them at any time and may see a sample-old value.
+ */
+struct ProcessStats {
+    // Bucket b counts process() calls taking [2^(b-1), 2^b) ns; the last is open.
+    static const int NUM_BUCKETS = 24;
+
+    std::atomic<uint64_t> clockEdges;
+    std::atomic<uint64_t> resets;
+    std::atomic<uint64_t> randomizations;
+    // Chords computed ahead of the edges, and those of them computed on an
+    // edge before its outputs went out: a key that changed on the edge
+    std::atomic<uint64_t> chords;
+    std::atomic<uint64_t> edgeChords;
+    std::atomic<uint64_t> triggerHistogram[NUM_BUCKETS];
+    std::atomic<uint64_t> sampleHistogram[NUM_BUCKETS];
+    std::atomic<uint64_t> worstTriggerNs;
+
+    typedef std::chrono::steady_clock Clock;
+
+    ProcessStats() {
+        reset();
+    }
+
+    // Not synchronized with the audio thread: a count may survive a reset.
+    void reset() {
+        clockEdges.store(0, std::memory_order_relaxed);
+        resets.store(0, std::memory_order_relaxed);
+        randomizations.store(0, std::memory_order_relaxed);
+        chords.store(0, std::memory_order_relaxed);
+        edgeChords.store(0, std::memory_order_relaxed);
+        for (int b = 0; b < NUM_BUCKETS; b++) {
+            triggerHistogram[b].store(0, std::memory_order_relaxed);
+            sampleHistogram[b].store(0, std::memory_order_relaxed);
+        }
+        worstTriggerNs.store(0, std::memory_order_relaxed);
+    }
+
+    // Single writer, so a plain load and store is enough.
+    static void add(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static int getBucket(uint64_t ns) {
+        int bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+        return std::min(bucket, NUM_BUCKETS - 1);
+    }
+
+    void record(bool trigger, Clock::time_point start, Clock::time_point end) {
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        if (trigger) {
+            add(triggerHistogram[getBucket(ns)], 1);
+            if (ns > worstTriggerNs.load(std::memory_order_relaxed))
+                worstTriggerNs.store(ns, std::memory_order_relaxed);
+        }
+        else {
+            add(sampleHistogram[getBucket(ns)], 1);
+        }
+    }
+
+    static json_t* histogramToJson(const std::atomic<uint64_t>* histogram) {
+        json_t* histogramJ = json_array();
+        for (int b = 0; b < NUM_BUCKETS; b++)
+            json_array_append_new(histogramJ, json_integer((json_int_t) histogram[b].load(std::memory_order_relaxed)));
+        return histogramJ;
+    }
+
+    json_t* toJson() const {
+        json_t* rootJ = json_object();
+        json_object_set_new(rootJ, "clockEdges", json_integer((json_int_t) clockEdges.load(std::memory_order_relaxed)));
+        json_object_set_new(rootJ, "resets", json_integer((json_int_t) resets.load(std::memory_order_relaxed)));
+        json_object_set_new(rootJ, "randomizations", json_integer((json_int_t) randomizations.load(std::memory_order_relaxed)));
+        json_object_set_new(rootJ, "chords", json_integer((json_int_t) chords.load(std::memory_order_relaxed)));
+        json_object_set_new(rootJ, "edgeChords", json_integer((json_int_t) edgeChords.load(std::memory_order_relaxed)));
+        json_object_set_new(rootJ, "worstTriggerNs", json_integer((json_int_t) worstTriggerNs.load(std::memory_order_relaxed)));
+        // Bucket b: [2^(b-1), 2^b) ns
+        json_object_set_new(rootJ, "triggerHistogramLog2Ns", histogramToJson(triggerHistogram));
+        json_object_set_new(rootJ, "sampleHistogramLog2Ns", histogramToJson(sampleHistogram));
+        return rootJ;
+    }
+};
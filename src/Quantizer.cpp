@@ -0,0 +1,22 @@
+#include "Quantizer.hpp"
+
+int8_t Quantizer::SNAP_TABLE[4096][12];
+
+// Filled while the plugin library loads, long before any audio thread runs.
+static struct SnapTableBuilder {
+    SnapTableBuilder() {
+        for (int mask = 0; mask < 4096; mask++) {
+            for (int pc = 0; pc < 12; pc++) {
+                int offset = 0;
+                if (mask) {
+                    // Search outwards, below before above, so ties round down
+                    for (int d = 0; d <= 6; d++) {
+                        if (mask & (1 << eucMod(pc - d, 12))) { offset = -d; break; }
+                        if (mask & (1 << eucMod(pc + d, 12))) { offset = d; break; }
+                    }
+                }
+                Quantizer::SNAP_TABLE[mask][pc] = (int8_t)offset;
+            }
+        }
+    }
+} snapTableBuilder;
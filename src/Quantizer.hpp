@@ -0,0 +1,41 @@
+#pragma once
+#include "plugin.hpp"
+
+/**
+ * Quantizer.hpp
+ * Snaps 1V/oct voltages to the nearest note of a pitch-class set, held as a
+ * 12-bit mask (bit n = pitch class n, C = 0). The nearest member of every set
+ * from every pitch class is precomputed, so changing the set copies one
+ * 12-entry row and snapping is float_4 arithmetic plus one lookup per channel.
+ */
+struct Quantizer {
+    // Semitones from each pitch class to the nearest member of each set, ties
+    // rounding down. With the empty set notes only round to the semitone.
+    static int8_t SNAP_TABLE[4096][12];
+
+    uint16_t mask = 0;
+    // The current set's row, in volts. Padded to 16 so a lane index can be
+    // masked instead of range-checked.
+    float offsets[16] = {};
+
+    void setMask(uint16_t newMask) {
+        newMask &= 0xfff;
+        if (newMask == mask) return;
+        mask = newMask;
+        for (int pc = 0; pc < 12; pc++)
+            offsets[pc] = SNAP_TABLE[mask][pc] / 12.f;
+    }
+
+    simd::float_4 process(simd::float_4 v) const {
+        simd::float_4 semitones = simd::round(simd::clamp(v, -12.f, 12.f) * 12.f);
+        simd::float_4 pc = semitones - 12.f * simd::floor(semitones * (1.f / 12.f));
+        simd::float_4 offset(offsets[(int)pc[0] & 15], offsets[(int)pc[1] & 15], offsets[(int)pc[2] & 15], offsets[(int)pc[3] & 15]);
+        return semitones * (1.f / 12.f) + offset;
+    }
+
+    // Rotates a mask relative to a root up by the root's pitch class.
+    static uint16_t transpose(uint16_t mask, int semitones) {
+        int r = eucMod(semitones, 12);
+        return ((mask << r) | (mask >> (12 - r))) & 0xfff;
+    }
+};
@@ -0,0 +1,314 @@
+#include "ScaleLibrary.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+
+// Built-in scales as plain constexpr data, so building the library needs no
+// per-scale allocations.
+struct ScaleDef {
+    const char* name;
+    int size;
+    int notes[12];
+};
+
+static constexpr ScaleDef BUILTIN_SCALES[] = {
+    {"Chromatic", 12, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}},
+    {"Tritone", 6, {0, 1, 4, 6, 7, 10}},
+    {"Two-Semi Tritone", 6, {0, 1, 2, 6, 7, 8}},
+
+    {"Major (Ionian)", 7, {0, 2, 4, 5, 7, 9, 11}},
+    {"Major Pentatonic", 5, {0, 2, 4, 7, 9}},
+    {"Major Bebop", 8, {0, 2, 4, 5, 7, 8, 9, 11}},
+    {"Major Locrian", 7, {0, 2, 4, 5, 6, 8, 10}},
+
+    {"Natural Minor", 7, {0, 2, 3, 5, 7, 8, 10}},
+    {"Minor Pentatonic", 5, {0, 3, 5, 7, 10}},
+    {"Harmonic Minor", 7, {0, 2, 3, 5, 7, 8, 11}},
+    {"Melodic Minor", 7, {0, 2, 3, 5, 7, 9, 11}},
+
+    {"Dorian", 7, {0, 2, 3, 5, 7, 9, 10}},
+    {"Phrygian", 7, {0, 1, 3, 5, 7, 8, 10}},
+    {"Lydian", 7, {0, 2, 4, 6, 7, 9, 11}},
+    {"Mixolydian", 7, {0, 2, 4, 5, 7, 9, 10}},
+    {"Locrian", 7, {0, 1, 3, 5, 6, 8, 10}},
+
+    {"Lydian Dominant", 7, {0, 2, 4, 6, 7, 9, 10}},
+    {"Lydian Augmented", 7, {0, 2, 4, 6, 8, 9, 11}},
+    {"Lydian Diminished", 7, {0, 2, 3, 6, 7, 9, 11}},
+
+    {"Phrygian Dominant", 7, {0, 1, 4, 5, 7, 8, 10}},
+    {"Locrian Nat6", 7, {0, 1, 3, 5, 6, 9, 10}},
+    {"Super Locrian", 7, {0, 1, 3, 4, 6, 8, 10}},
+
+    {"Blues", 6, {0, 3, 5, 6, 7, 10}},
+    {"Double Harmonic", 7, {0, 1, 4, 5, 7, 8, 11}},
+    {"Hungarian Minor", 7, {0, 2, 3, 6, 7, 8, 11}},
+    {"Hungarian Major", 7, {0, 3, 4, 6, 7, 9, 10}},
+    {"Persian", 7, {0, 1, 4, 5, 6, 8, 11}},
+    {"Hirajoshi", 5, {0, 2, 3, 7, 8}},
+    {"Iwato", 5, {0, 1, 5, 6, 10}},
+    {"In Sen", 5, {0, 1, 5, 7, 10}},
+    {"Yo", 5, {0, 2, 5, 7, 9}},
+
+    {"Whole Tone", 6, {0, 2, 4, 6, 8, 10}},
+    {"Augmented", 6, {0, 3, 4, 7, 8, 11}},
+    {"Octatonic (H-W)", 8, {0, 1, 3, 4, 6, 7, 9, 10}},
+    {"Enigmatic", 7, {0, 1, 4, 6, 8, 10, 11}},
+    {"Prometheus", 6, {0, 2, 4, 6, 9, 10}},
+    {"Harmonic Major", 7, {0, 2, 4, 5, 7, 8, 11}},
+    {"Neapolitan Maj", 7, {0, 1, 3, 5, 7, 9, 11}},
+    {"Neapolitan Min", 7, {0, 1, 3, 5, 7, 8, 11}},
+    {"Bebop Dominant", 8, {0, 2, 4, 5, 7, 9, 10, 11}},
+    {"Algerian", 8, {0, 2, 3, 5, 6, 7, 8, 11}},
+    {"Ukrainian Dorian", 7, {0, 2, 3, 6, 7, 9, 10}},
+    {"Istrian", 6, {0, 1, 3, 4, 6, 7}},
+};
+
+// The library audio threads read, and every library built since startup
+// that may still be read. A retired one waits here for the readers to move
+// past its epoch; see ScaleLibrary::Reader.
+struct OwnedLibrary {
+    std::unique_ptr<ScaleLibrary> library;
+    bool retired;
+    uint32_t retiredEpoch;
+};
+
+static std::atomic<const ScaleLibrary*> published(nullptr);
+static std::mutex reloadMutex;
+static std::vector<OwnedLibrary> libraries;
+static std::vector<ScaleLibrary::Reader*> readers;
+static std::atomic<uint32_t> epoch(1);
+static std::atomic<int> numRetired(0);
+static std::atomic<uint32_t> nextId(1);
+
+const ScaleLibrary* ScaleLibrary::current() {
+    const ScaleLibrary* library = published.load(std::memory_order_acquire);
+    if (library) return library;
+
+    static const std::unique_ptr<ScaleLibrary> builtin(build(false));
+    return builtin.get();
+}
+
+const ScaleLibrary* ScaleLibrary::buildTuned(const Tuning& tuning) {
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    std::unique_ptr<ScaleLibrary> library(new ScaleLibrary);
+    const ScaleLibrary* base = current();
+    library->base = base;
+
+    int numSteps = tuning.size();
+    for (const Scale& s : base->scales) {
+        // Nearest steps, scaled to the period, in order and without repeats
+        int notes[MAX_SCALE_NOTES];
+        int size = 0;
+        for (int i = 0; i < s.size; i++) {
+            int note = eucMod(tuning.getNearestStep(s.notes[i] / 12.f * tuning.period), numSteps);
+            if (size == 0 || note > notes[size - 1]) notes[size++] = note;
+        }
+        library->addScale(s.name, notes, size, numSteps);
+    }
+    library->numBuiltin = base->numBuiltin;
+    // Every step of the tuning, unless Chromatic already is
+    if (numSteps != 12 && numSteps <= MAX_SCALE_NOTES) {
+        int notes[MAX_SCALE_NOTES];
+        for (int i = 0; i < numSteps; i++)
+            notes[i] = i;
+        library->addScale(tuning.name.c_str(), notes, numSteps, numSteps);
+    }
+    library->buildChords(tuning);
+
+    library->id = nextId++;
+
+    const ScaleLibrary* result = library.get();
+    libraries.push_back(OwnedLibrary{std::move(library), false, 0});
+    return result;
+}
+
+void ScaleLibrary::reload() {
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    std::unique_ptr<ScaleLibrary> library(build(true));
+    const ScaleLibrary* replaced = published.exchange(library.get(), std::memory_order_acq_rel);
+    libraries.push_back(OwnedLibrary{std::move(library), false, 0});
+    if (replaced) retireLocked(replaced);
+}
+
+void ScaleLibrary::addReader(Reader* reader) {
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    reader->mark(epoch.load(std::memory_order_acquire));
+    readers.push_back(reader);
+}
+
+void ScaleLibrary::removeReader(Reader* reader) {
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    readers.erase(std::remove(readers.begin(), readers.end(), reader), readers.end());
+}
+
+uint32_t ScaleLibrary::getEpoch() {
+    return epoch.load(std::memory_order_acquire);
+}
+
+void ScaleLibrary::retire(const ScaleLibrary* library) {
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    retireLocked(library);
+}
+
+// The new epoch is published after the pointer the library was taken out
+// of, so a reader that reads it loads the replacement.
+void ScaleLibrary::retireLocked(const ScaleLibrary* library) {
+    for (OwnedLibrary& owned : libraries) {
+        if (owned.library.get() == library && !owned.retired) {
+            owned.retired = true;
+            owned.retiredEpoch = epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+            numRetired++;
+        }
+    }
+    collectLocked();
+}
+
+void ScaleLibrary::collect() {
+    if (numRetired.load(std::memory_order_relaxed) == 0) return;
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    collectLocked();
+}
+
+// A tuned library keeps its base alive, so a retired base goes in the pass
+// after the last library built from it.
+void ScaleLibrary::collectLocked() {
+    bool freed = true;
+    while (freed) {
+        freed = false;
+        for (size_t i = 0; i < libraries.size(); i++) {
+            const OwnedLibrary& owned = libraries[i];
+            bool unused = owned.retired;
+            for (const Reader* reader : readers)
+                unused = unused && (int32_t)(reader->epoch.load(std::memory_order_acquire) - owned.retiredEpoch) >= 0;
+            for (const OwnedLibrary& other : libraries)
+                unused = unused && other.library->base != owned.library.get();
+            if (unused) {
+                libraries.erase(libraries.begin() + i--);
+                numRetired--;
+                freed = true;
+            }
+        }
+    }
+}
+
+int ScaleLibrary::getNumLive() {
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    return (int)libraries.size();
+}
+
+std::string ScaleLibrary::getUserScalesPath() {
+    return asset::user("ChordChemist/scales.json");
+}
+
+ScaleLibrary* ScaleLibrary::build(bool includeUserScales) {
+    ScaleLibrary* library = new ScaleLibrary;
+    for (const ScaleDef& def : BUILTIN_SCALES)
+        library->addScale(def.name, def.notes, def.size, 12);
+    library->numBuiltin = library->size();
+
+    if (includeUserScales)
+        library->loadUserScales(getUserScalesPath());
+
+    library->buildChords(Tuning());
+    library->id = nextId++;
+    return library;
+}
+
+// The mask is left to buildChords(), which knows the tuning.
+void ScaleLibrary::addScale(const char* name, const int* notes, int size, int numSteps) {
+    Scale scale;
+    std::memset(&scale, 0, sizeof(scale));
+    std::strncpy(scale.name, name, sizeof(scale.name) - 1);
+    scale.size = (uint8_t)clamp(size, 1, MAX_SCALE_NOTES);
+    for (int i = 0; i < scale.size; i++)
+        scale.notes[i] = (uint8_t)clamp(notes[i], 0, numSteps - 1);
+    scales.push_back(scale);
+}
+
+// Format: {"scales": [{"name": "Hijaz", "notes": [0, 1, 4, 5, 7, 8, 10]}, ...]}
+// Notes are semitones above the root, 0-11. They are sorted and de-duplicated.
+void ScaleLibrary::loadUserScales(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "r");
+    if (!file) return;
+
+    json_error_t error;
+    json_t* rootJ = json_loadf(file, 0, &error);
+    std::fclose(file);
+    if (!rootJ) {
+        WARN("ChordChemist: cannot parse %s line %d: %s", path.c_str(), error.line, error.text);
+        return;
+    }
+
+    json_t* scalesJ = json_object_get(rootJ, "scales");
+    size_t i;
+    json_t* scaleJ;
+    json_array_foreach(scalesJ, i, scaleJ) {
+        const char* name = json_string_value(json_object_get(scaleJ, "name"));
+        json_t* notesJ = json_object_get(scaleJ, "notes");
+
+        bool present[12] = {};
+        bool valid = name && json_is_array(notesJ);
+        size_t j;
+        json_t* noteJ;
+        json_array_foreach(notesJ, j, noteJ) {
+            int note = (int)json_integer_value(noteJ);
+            if (note < 0 || note > 11) valid = false;
+            else present[note] = true;
+        }
+
+        int notes[12];
+        int size = 0;
+        for (int note = 0; note < 12; note++)
+            if (present[note]) notes[size++] = note;
+
+        if (!valid || size == 0) {
+            WARN("ChordChemist: skipping invalid scale %d in %s", (int)i, path.c_str());
+            continue;
+        }
+        addScale(name, notes, size, 12);
+    }
+    json_decref(rootJ);
+}
+
+// Pitch classes are the nearest 12-TET ones, so chords in any tuning can be
+// named and quantized with the 12-bit tables.
+static int getPitchClass(float volts) {
+    return eucMod((int)std::round(volts * 12.f), 12);
+}
+
+void ScaleLibrary::buildChords(const Tuning& tuning) {
+    for (int r = 0; r < NUM_ROOTS; r++)
+        rootVoltages[r] = tuning.getVoltage(tuning.getNearestStep(r / 12.0f)) + tuning.offset;
+    period = tuning.period;
+
+    chords.resize(scales.size() * NUM_DEGREES * NUM_QUALITIES);
+    for (int sc = 0; sc < size(); sc++) {
+        Scale& s = scales[sc];
+        s.mask = 0;
+        for (int i = 0; i < s.size; i++) {
+            s.voltages[i] = tuning.getVoltage(s.notes[i]);
+            s.mask |= 1 << getPitchClass(s.voltages[i]);
+        }
+
+        for (int degree = 0; degree < NUM_DEGREES; degree++) {
+            int interval = s.notes[degree % s.size];
+
+            for (int quality = 0; quality < NUM_QUALITIES; quality++) {
+                ChordEntry& e = chords[(sc * NUM_DEGREES + degree) * NUM_QUALITIES + quality];
+                e.mask = 0;
+                for (int k = 0; k < 4; k++) {
+                    int scaleIndexRaw = degree + (k < 3 ? k * 2 : QUALITY_EXTENSIONS[quality]);
+                    int note = s.notes[scaleIndexRaw % s.size];
+                    int octaveShift = scaleIndexRaw / s.size;
+                    e.voltages[k] = tuning.getVoltage(note) + octaveShift * tuning.period;
+                    e.mask |= 1 << getPitchClass(tuning.getVoltage(note));
+                }
+                e.rootOffset = (uint8_t)getPitchClass(tuning.getVoltage(interval));
+            }
+        }
+    }
+}
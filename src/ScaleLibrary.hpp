@@ -0,0 +1,130 @@
+#pragma once
+/**
+ * ScaleLibrary.hpp
+ * Process-wide, immutable scale registry: the built-in scales plus any user
+ * scales, with the chord table for all of them. Built off the audio thread
+ * and published through an atomic pointer, so every ChordCircle instance
+ * shares one copy and picks up reloads without locking. A replaced library
+ * is freed on the UI thread once no audio thread can still be reading it.
+ */
+
+#include "plugin.hpp"
+#include "Tuning.hpp"
+#include <atomic>
+#include <vector>
+#include <string>
+
+static const int NUM_DEGREES = 7;    // STEP_DEGREE params run 0..6
+static const int NUM_QUALITIES = 5;  // Extension: 7th, octave, 6th, 9th, 11th
+static const int NUM_ROOTS = 61;     // ROOT_NOTE param runs 0..60
+static const int MAX_SCALE_NOTES = 32;
+
+// Scale-step offset of the fourth voice for each step quality.
+static const int QUALITY_EXTENSIONS[NUM_QUALITIES] = {6, 0, 5, 8, 10};
+static const char* const QUALITY_NAMES[NUM_QUALITIES] = {"7th", "Octave", "6th", "9th", "11th"};
+
+static const char* const NOTE_NAMES[12] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+
+struct ChordEntry {
+    float voltages[4];   // 1V/oct, relative to the root note
+    // The nearest 12-TET pitch classes, for naming and quantizing
+    uint16_t mask;       // Pitch classes of the voices, relative to the root note
+    uint8_t rootOffset;  // Semitones from the root note to the chord root
+};
+
+struct ScaleLibrary {
+    // Fixed-size record, so the whole list is one contiguous block.
+    struct Scale {
+        char name[32];
+        uint8_t size;
+        uint8_t notes[MAX_SCALE_NOTES];   // Steps of the tuning above the root
+        float voltages[MAX_SCALE_NOTES];  // The same notes in volts
+        uint16_t mask;   // Bit n set when a note is nearest n semitones above the root
+    };
+
+    std::vector<Scale> scales;
+    int numBuiltin = 0;
+    // Unique per library, unlike its address once freed ones are reused
+    uint32_t id = 0;
+    // For a library built by buildTuned(), the 12-TET library it was mapped
+    // from; null for the 12-TET ones.
+    const ScaleLibrary* base = nullptr;
+
+    // Every chord the sequencer can play, [scale][degree][quality] flattened.
+    // The root note is a pure 1V/oct offset, so it gets its own small table
+    // instead of multiplying the chord table by 61. In other tunings each
+    // root is the tuning's nearest step to that 12-TET note.
+    std::vector<ChordEntry> chords;
+    float rootVoltages[NUM_ROOTS];
+    float period = 1.f;   // Of the tuning, in volts
+
+    int size() const {
+        return (int)scales.size();
+    }
+
+    const ChordEntry& getChord(int scale, int degree, int quality) const {
+        return chords[(scale * NUM_DEGREES + degree) * NUM_QUALITIES + quality];
+    }
+
+    // A scale note above the root note. `index` may run past the scale's
+    // size into the periods above.
+    float getScaleVoltage(int scale, int index) const {
+        const Scale& s = scales[scale];
+        return s.voltages[index % s.size] + (index / s.size) * period;
+    }
+
+    // The published library. Never null: before the first reload() it is the
+    // built-in list, built by whichever non-audio thread asks first.
+    static const ScaleLibrary* current();
+
+    // Rebuilds from the built-in scales plus the user file and publishes the
+    // result. UI/plugin-init thread only. The replaced library is retired.
+    static void reload();
+
+    // The current() scales mapped onto `tuning`: every note moves to the
+    // tuning's nearest step, and a Scala scale that fits is added as a scale
+    // of its own. Not published; the caller gives it to one module and
+    // retires it when the module lets go. UI thread only.
+    static const ScaleLibrary* buildTuned(const Tuning& tuning);
+
+    // One per module that reads libraries on an audio thread. On every
+    // refresh the audio thread stores the epoch it read before loading any
+    // library pointer: a library retired before that epoch can no longer be
+    // loaded, so once every reader is past it nothing holds it.
+    struct Reader {
+        std::atomic<uint32_t> epoch{0};
+
+        // Audio thread, after picking up the library loaded after getEpoch()
+        void mark(uint32_t seen) {
+            epoch.store(seen, std::memory_order_release);
+        }
+    };
+
+    // UI thread: a module joins before it reads a library, and leaves once
+    // it is out of the engine.
+    static void addReader(Reader* reader);
+    static void removeReader(Reader* reader);
+    // Any thread: the epoch to mark a reader with, read before the pointers.
+    static uint32_t getEpoch();
+
+    // UI thread. `library` is no longer in any pointer a reader loads from;
+    // it is freed once every reader has marked a later epoch, and no tuned
+    // library still names it as its base.
+    static void retire(const ScaleLibrary* library);
+    // UI thread: frees what retire() queued, when it is safe. Cheap when
+    // nothing is queued, so it can run every frame.
+    static void collect();
+    // Libraries built since startup and not yet freed
+    static int getNumLive();
+
+    // <Rack user folder>/ChordChemist/scales.json
+    static std::string getUserScalesPath();
+
+private:
+    static ScaleLibrary* build(bool includeUserScales);
+    static void retireLocked(const ScaleLibrary* library);
+    static void collectLocked();
+    void addScale(const char* name, const int* notes, int size, int numSteps);
+    void loadUserScales(const std::string& path);
+    void buildChords(const Tuning& tuning);
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * SeqLock.hpp
+ * Single-writer, multi-reader sequence lock for small trivially copyable
+ * structs. The writer (the audio thread) never blocks or allocates; readers
+ * retry or skip a frame when they raced a write. The payload is stored as
+ * relaxed atomic words, so a torn read is detected rather than undefined.
+ */
+template <typename T>
+struct SeqLock {
+    static const size_t WORDS = (sizeof(T) + 3) / 4;
+
+    // Keeps the shared words off the cache lines of neighbouring members.
+    char paddingBefore[64];
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> words[WORDS];
+    char paddingAfter[64];
+
+    SeqLock() {
+        sequence.store(0, std::memory_order_relaxed);
+        for (size_t i = 0; i < WORDS; i++)
+            words[i].store(0, std::memory_order_relaxed);
+    }
+
+    // Writer thread only.
+    void write(const T& value) {
+        uint32_t buffer[WORDS] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++)
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Returns false when a write was in progress; `value` is left untouched.
+    bool tryRead(T& value) const {
+        uint32_t seq0 = sequence.load(std::memory_order_acquire);
+        if (seq0 & 1) return false;
+
+        uint32_t buffer[WORDS];
+        for (size_t i = 0; i < WORDS; i++)
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (sequence.load(std::memory_order_relaxed) != seq0) return false;
+        std::memcpy(&value, buffer, sizeof(T));
+        return true;
+    }
+
+    // Even and changed since the last call means a new value was published.
+    uint32_t getSequence() const {
+        return sequence.load(std::memory_order_acquire);
+    }
+};
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include "Xoshiro.hpp"
+
+/**
+ * StrumScheduler.hpp
+ * Spreads the four voices of a chord over time. A clock edge schedules a
+ * note-on (and for arpeggios a note-off) per voice into a fixed ring buffer,
+ * already in time order, so draining it is one comparison per sample until
+ * an event is due. Times are the module's own sample count and may wrap.
+ */
+struct StrumEvent {
+    uint32_t time;
+    float voltage;   // Pitch the voice takes at a note-on
+    uint8_t voice;
+    bool gate;
+};
+
+struct StrumScheduler {
+    enum Mode {
+        MODE_OFF,        // All voices at once, gates held until the next edge
+        MODE_STRUM,      // One voice after another, gates held until the next edge
+        MODE_ARPEGGIO,   // One voice after another, each gate open for half the spacing
+        NUM_MODES
+    };
+
+    enum Order {
+        ORDER_UP,        // Lowest voice first
+        ORDER_DOWN,
+        ORDER_RANDOM,
+        NUM_ORDERS
+    };
+
+    // Power of two; one chord takes at most 8 events
+    static const uint32_t CAPACITY = 16;
+
+    StrumEvent events[CAPACITY];
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    Xoshiro128 rng;
+
+    bool isEmpty() const {
+        return head == tail;
+    }
+
+    // Events must arrive in time order. A full buffer drops them.
+    void push(uint32_t time, float voltage, int voice, bool gate) {
+        if (tail - head == CAPACITY) return;
+        StrumEvent& e = events[tail++ & (CAPACITY - 1)];
+        e.time = time;
+        e.voltage = voltage;
+        e.voice = (uint8_t) voice;
+        e.gate = gate;
+    }
+
+    // Takes the next event due at `now`, if any.
+    bool pop(uint32_t now, StrumEvent& e) {
+        if (isEmpty() || (int32_t)(events[head & (CAPACITY - 1)].time - now) > 0) return false;
+        e = events[head++ & (CAPACITY - 1)];
+        return true;
+    }
+
+    // Takes the next event whether due or not, to finish a chord early.
+    bool popAny(StrumEvent& e) {
+        if (isEmpty()) return false;
+        e = events[head++ & (CAPACITY - 1)];
+        return true;
+    }
+
+    // New pitches for the note-ons still pending, when the chord changes
+    // under a strum.
+    void retune(const float voltages[4]) {
+        for (uint32_t i = head; i != tail; i++) {
+            StrumEvent& e = events[i & (CAPACITY - 1)];
+            e.voltage = voltages[e.voice];
+        }
+    }
+
+    // Bit k set while voice k has a note-on still to come
+    int getPendingVoices() const {
+        int mask = 0;
+        for (uint32_t i = head; i != tail; i++) {
+            const StrumEvent& e = events[i & (CAPACITY - 1)];
+            if (e.gate) mask |= 1 << e.voice;
+        }
+        return mask;
+    }
+
+    // Voice k of the chord starts at `start` plus its rank in `order` times
+    // `spacing` samples.
+    void schedule(const float voltages[4], uint32_t start, uint32_t spacing, int mode, int order) {
+        int voices[4] = {0, 1, 2, 3};
+        if (order == ORDER_RANDOM) {
+            for (int i = 3; i > 0; i--)
+                std::swap(voices[i], voices[rng.next() % (i + 1)]);
+        }
+        else {
+            // By pitch, which voice leading may have reordered
+            for (int i = 1; i < 4; i++)
+                for (int j = i; j > 0 && voltages[voices[j]] < voltages[voices[j - 1]]; j--)
+                    std::swap(voices[j], voices[j - 1]);
+            if (order == ORDER_DOWN) {
+                std::swap(voices[0], voices[3]);
+                std::swap(voices[1], voices[2]);
+            }
+        }
+
+        if (mode == MODE_OFF) spacing = 0;
+        // Two samples at least, so each note-off falls before the next note-on
+        if (mode == MODE_ARPEGGIO) spacing = std::max(spacing, (uint32_t) 2);
+        for (int rank = 0; rank < 4; rank++) {
+            int voice = voices[rank];
+            uint32_t time = start + rank * spacing;
+            push(time, voltages[voice], voice, true);
+            if (mode == MODE_ARPEGGIO) push(time + spacing / 2, voltages[voice], voice, false);
+        }
+    }
+};
@@ -0,0 +1,206 @@
+#include "Tuning.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+// A mapping moves the whole tuning by at most an octave either way; the
+// ROOT knob covers the rest. Checked on loading a .kbm and a patch alike.
+static bool isValidOffset(float offset) {
+    return std::fabs(offset) <= 1.f;
+}
+
+// Reads the next line that is not a "!" comment, without its line ending.
+static bool readLine(FILE* file, std::string& line) {
+    char buffer[512];
+    while (std::fgets(buffer, sizeof(buffer), file)) {
+        if (buffer[0] == '!') continue;
+        line = buffer;
+        line.erase(line.find_last_not_of("\r\n") + 1);
+        return true;
+    }
+    return false;
+}
+
+// Like readLine(), also skipping blank lines, and returning the first token.
+static bool readToken(FILE* file, std::string& token) {
+    std::string line;
+    while (readLine(file, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos) continue;
+        size_t end = line.find_first_of(" \t", start);
+        token = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        return true;
+    }
+    return false;
+}
+
+// A Scala pitch is in cents when it has a period, otherwise a ratio "3/2"
+// or a whole number "2". Returns volts, or NAN when malformed.
+static float parsePitch(const std::string& token) {
+    const char* s = token.c_str();
+    char* end;
+    if (token.find('.') != std::string::npos) {
+        double cents = std::strtod(s, &end);
+        return (end == s) ? NAN : (float)(cents / 1200.0);
+    }
+    long numerator = std::strtol(s, &end, 10);
+    long denominator = 1;
+    if (end == s) return NAN;
+    if (*end == '/') {
+        const char* d = end + 1;
+        denominator = std::strtol(d, &end, 10);
+        if (end == d) return NAN;
+    }
+    if (numerator <= 0 || denominator <= 0) return NAN;
+    return (float)std::log2((double)numerator / denominator);
+}
+
+static bool parseInt(const std::string& token, int& value) {
+    char* end;
+    value = (int)std::strtol(token.c_str(), &end, 10);
+    return end != token.c_str();
+}
+
+// Format: http://www.huygens-fokker.org/scala/scl_format.html
+// The last pitch is the period. Pitches are sorted, and ones not strictly
+// inside the period are dropped, so steps always ascend from 0.
+bool Tuning::loadScala(const std::string& path, std::string& error) {
+    FILE* file = std::fopen(path.c_str(), "r");
+    if (!file) {
+        error = "cannot open file";
+        return false;
+    }
+
+    std::string description;
+    std::string token;
+    int count = 0;
+    std::vector<float> pitches;
+    bool valid = readLine(file, description) && readToken(file, token) && parseInt(token, count)
+        && count >= 1 && count <= MAX_STEPS;
+    for (int i = 0; valid && i < count; i++) {
+        float pitch = readToken(file, token) ? parsePitch(token) : NAN;
+        valid = std::isfinite(pitch);
+        pitches.push_back(pitch);
+    }
+    std::fclose(file);
+
+    if (!valid) {
+        error = "not a valid Scala file";
+        return false;
+    }
+    float newPeriod = pitches.back();
+    if (newPeriod <= 0.f) {
+        error = "the period is not above the first step";
+        return false;
+    }
+
+    std::vector<float> newSteps(1, 0.f);
+    for (int i = 0; i < count - 1; i++)
+        if (pitches[i] > 0.f && pitches[i] < newPeriod) newSteps.push_back(pitches[i]);
+    std::sort(newSteps.begin(), newSteps.end());
+    newSteps.erase(std::unique(newSteps.begin(), newSteps.end()), newSteps.end());
+
+    size_t start = description.find_first_not_of(" \t");
+    name = (start == std::string::npos) ? system::getStem(path) : description.substr(start);
+    steps = newSteps;
+    period = newPeriod;
+    offset = 0.f;   // A mapping made for the old scale no longer applies
+    return true;
+}
+
+// Format: http://www.huygens-fokker.org/scala/help.htm#mappings
+// Only the reference pitch is used: it sets `offset`, so the mapping's
+// reference note sounds at its reference frequency when the ROOT knob is on
+// the middle note's pitch class. Notes keep following the scale in order.
+bool Tuning::loadKeyboardMapping(const std::string& path, std::string& error) {
+    FILE* file = std::fopen(path.c_str(), "r");
+    if (!file) {
+        error = "cannot open file";
+        return false;
+    }
+
+    // Map size, first note, last note, middle note, reference note,
+    // reference frequency, formal octave degree, then the map itself
+    std::string token;
+    int header[7] = {};
+    float referenceFrequency = 0.f;
+    bool valid = true;
+    for (int i = 0; valid && i < 7; i++) {
+        valid = readToken(file, token);
+        if (i == 5) referenceFrequency = (float)std::atof(token.c_str());
+        else valid = valid && parseInt(token, header[i]);
+    }
+    int mapSize = header[0];
+    int middleNote = header[3];
+    int referenceNote = header[4];
+    int octaveDegree = header[6] > 0 ? header[6] : size();
+    valid = valid && mapSize >= 0 && mapSize <= MAX_STEPS && referenceFrequency > 0.f;
+
+    // Scale degree of the reference note, "x" for unmapped keys
+    int distance = referenceNote - middleNote;
+    int referenceDegree = distance;
+    if (valid && mapSize > 0) {
+        int index = eucMod(distance, mapSize);
+        for (int i = 0; valid && i <= index; i++)
+            valid = readToken(file, token);
+        if (valid && !parseInt(token, referenceDegree)) {
+            error = "the reference note is unmapped";
+            std::fclose(file);
+            return false;
+        }
+        referenceDegree += eucDiv(distance, mapSize) * octaveDegree;
+    }
+    std::fclose(file);
+
+    if (!valid) {
+        error = "not a valid keyboard mapping";
+        return false;
+    }
+    // Where 12-TET would put the middle note, relative to where it has to be
+    float middleVoltage = std::log2(referenceFrequency / dsp::FREQ_C4) - getVoltage(referenceDegree);
+    float newOffset = middleVoltage - (middleNote - 60) / 12.f;
+    if (!isValidOffset(newOffset)) {
+        error = "the reference pitch is more than an octave from the middle note";
+        return false;
+    }
+    offset = newOffset;
+    return true;
+}
+
+json_t* Tuning::toJson() const {
+    json_t* rootJ = json_object();
+    json_object_set_new(rootJ, "name", json_string(name.c_str()));
+    json_t* stepsJ = json_array();
+    for (float step : steps)
+        json_array_append_new(stepsJ, json_real(step));
+    json_object_set_new(rootJ, "steps", stepsJ);
+    json_object_set_new(rootJ, "period", json_real(period));
+    json_object_set_new(rootJ, "offset", json_real(offset));
+    return rootJ;
+}
+
+// Anything malformed falls back to 12-EDO.
+void Tuning::fromJson(json_t* rootJ) {
+    setEdo(12);
+    json_t* stepsJ = json_object_get(rootJ, "steps");
+    float newPeriod = (float)json_number_value(json_object_get(rootJ, "period"));
+    size_t count = json_array_size(stepsJ);
+    if (count < 1 || count > (size_t)MAX_STEPS || !(newPeriod > 0.f)) return;
+
+    std::vector<float> newSteps;
+    size_t i;
+    json_t* stepJ;
+    json_array_foreach(stepsJ, i, stepJ) {
+        float step = (float)json_number_value(stepJ);
+        if (i == 0 ? step != 0.f : !(step > newSteps.back() && step < newPeriod)) return;
+        newSteps.push_back(step);
+    }
+
+    const char* nameS = json_string_value(json_object_get(rootJ, "name"));
+    name = nameS ? nameS : "Custom";
+    steps = newSteps;
+    period = newPeriod;
+    float newOffset = (float)json_number_value(json_object_get(rootJ, "offset"));
+    offset = isValidOffset(newOffset) ? newOffset : 0.f;
+}
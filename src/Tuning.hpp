@@ -0,0 +1,80 @@
+#pragma once
+#include "plugin.hpp"
+#include <vector>
+#include <string>
+
+/**
+ * Tuning.hpp
+ * A periodic tuning: the pitch of every step within one period, in volts
+ * above step 0. Equal divisions are generated, Scala .scl scales and .kbm
+ * keyboard mappings are parsed from files. UI thread only: the audio thread
+ * never sees a Tuning, just the chord tables ScaleLibrary builds from one.
+ */
+struct Tuning {
+    static const int MAX_STEPS = 128;
+
+    std::string name;
+    std::vector<float> steps;  // steps[0] = 0, ascending, all below the period
+    float period = 1.f;        // In volts; 1 for octave-repeating tunings
+    float offset = 0.f;        // Added to every pitch, from a keyboard mapping
+
+    Tuning() {
+        setEdo(12);
+    }
+
+    void setEdo(int divisions) {
+        divisions = clamp(divisions, 1, MAX_STEPS);
+        name = string::f("%d-EDO", divisions);
+        steps.resize(divisions);
+        for (int i = 0; i < divisions; i++)
+            steps[i] = (float)i / divisions;
+        period = 1.f;
+        offset = 0.f;
+    }
+
+    int size() const {
+        return (int)steps.size();
+    }
+
+    // 12-EDO with no mapping: the tables this builds are the plain 12-TET ones.
+    bool isStandard() const {
+        if (size() != 12 || period != 1.f || offset != 0.f) return false;
+        for (int i = 0; i < 12; i++)
+            if (steps[i] != i / 12.f) return false;
+        return true;
+    }
+
+    // Any step, including ones outside the first period.
+    float getVoltage(int step) const {
+        int n = size();
+        return steps[eucMod(step, n)] + eucDiv(step, n) * period;
+    }
+
+    // The step closest in pitch to `volts`, ties going down.
+    int getNearestStep(float volts) const {
+        int n = size();
+        int periods = (int)std::floor(volts / period);
+        float within = volts - periods * period;
+        int best = 0;
+        float bestDistance = within;
+        for (int i = 1; i < n; i++) {
+            float distance = std::fabs(within - steps[i]);
+            if (distance < bestDistance) {
+                best = i;
+                bestDistance = distance;
+            }
+        }
+        // Step 0 of the next period
+        if (period - within < bestDistance) best = n;
+        return periods * n + best;
+    }
+
+    // Replace the steps and period, or set the offset. On failure the tuning
+    // is unchanged and `error` says why.
+    bool loadScala(const std::string& path, std::string& error);
+    bool loadKeyboardMapping(const std::string& path, std::string& error);
+
+    // Steps are saved in full, so a patch does not depend on the .scl file.
+    json_t* toJson() const;
+    void fromJson(json_t* rootJ);
+};
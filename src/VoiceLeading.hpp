@@ -0,0 +1,90 @@
+#pragma once
+#include <cmath>
+
+/**
+ * VoiceLeading.hpp
+ * Optimal 4-voice leading. Every assignment of chord tones to voices comes
+ * from a precomputed permutation table; each voice moves to the nearest
+ * octave of its tone, and the assignment with the least total movement wins.
+ * 24 candidates and fixed storage, so a clock edge costs bounded time and
+ * never allocates.
+ */
+namespace VoiceLeading {
+
+// All orderings of 4 chord tones, lexicographic. The first
+// NUM_BASS_PERMUTATIONS keep tone 0 on voice 0.
+static const int PERMUTATIONS[24][4] = {
+    {0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 1, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {0, 3, 2, 1},
+    {1, 0, 2, 3}, {1, 0, 3, 2}, {1, 2, 0, 3}, {1, 2, 3, 0}, {1, 3, 0, 2}, {1, 3, 2, 0},
+    {2, 0, 1, 3}, {2, 0, 3, 1}, {2, 1, 0, 3}, {2, 1, 3, 0}, {2, 3, 0, 1}, {2, 3, 1, 0},
+    {3, 0, 1, 2}, {3, 0, 2, 1}, {3, 1, 0, 2}, {3, 1, 2, 0}, {3, 2, 0, 1}, {3, 2, 1, 0}
+};
+static const int NUM_BASS_PERMUTATIONS = 6;
+
+// Voices further than this (in octaves, on average) from the root-position
+// chord are shifted back, so repeated leading cannot drift out of range.
+static const float MAX_DRIFT = 0.5f;
+
+// A single voice further than this outside the root-position chord is
+// folded back on its own: the average can stay in range while the voices
+// spread apart.
+static const float MAX_VOICE_DRIFT = 1.5f;
+
+// The assignment alone: each voice on its nearest octave of a tone, with the
+// least total movement. Returns that movement in octaves.
+inline float assign(const float prev[4], const float chord[4], bool keepBass, float out[4]) {
+    // Nearest octave of every tone for every voice
+    float candidates[4][4];
+    float distances[4][4];
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            candidates[i][j] = chord[j] + std::round(prev[i] - chord[j]);
+            distances[i][j] = std::fabs(candidates[i][j] - prev[i]);
+        }
+    }
+    if (keepBass) {
+        candidates[0][0] = chord[0];
+        distances[0][0] = std::fabs(chord[0] - prev[0]);
+    }
+
+    int numPermutations = keepBass ? NUM_BASS_PERMUTATIONS : 24;
+    int best = 0;
+    float bestCost = INFINITY;
+    for (int p = 0; p < numPermutations; p++) {
+        const int* perm = PERMUTATIONS[p];
+        float cost = distances[0][perm[0]] + distances[1][perm[1]] + distances[2][perm[2]] + distances[3][perm[3]];
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = p;
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+        out[i] = candidates[i][PERMUTATIONS[best][i]];
+    return bestCost;
+}
+
+// prev: voices currently sounding, chord: target tones in root position,
+// both 1V/oct. keepBass pins voice 0 to the chord root in its root-position
+// octave, for the SPREAD open voicing.
+inline void lead(const float prev[4], const float chord[4], bool keepBass, float out[4]) {
+    assign(prev, chord, keepBass, out);
+
+    int first = keepBass ? 1 : 0;
+    float drift = 0.f;
+    for (int i = first; i < 4; i++)
+        drift += out[i] - chord[i];
+    drift /= (4 - first);
+    // Equal-tempered drifts land exactly on MAX_DRIFT; those stay put however
+    // the sum rounded
+    float shift = (std::fabs(drift) > MAX_DRIFT + 1e-4f) ? std::round(drift) : 0.f;
+    float low = std::fmin(std::fmin(chord[0], chord[1]), std::fmin(chord[2], chord[3])) - MAX_VOICE_DRIFT;
+    float high = std::fmax(std::fmax(chord[0], chord[1]), std::fmax(chord[2], chord[3])) + MAX_VOICE_DRIFT;
+    for (int i = first; i < 4; i++) {
+        out[i] -= shift;
+        if (out[i] < low) out[i] += std::ceil(low - out[i]);
+        else if (out[i] > high) out[i] -= std::ceil(out[i] - high);
+    }
+}
+
+} // namespace VoiceLeading
@@ -0,0 +1,55 @@
+#pragma once
+#include "ScaleLibrary.hpp"
+
+/**
+ * Voicing.hpp
+ * Spreads a 4-voice chord over up to 16 POLY channels. Channels 1-4 keep
+ * the chord's four voices; the channels above add the stacked scale thirds
+ * past the 7th (9th, 11th, 13th) and their octaves, or octaves of the four
+ * voices. A drop voicing then moves the 2nd or 3rd highest voice down an
+ * octave. Fixed storage and at most 16 voices, so a clock edge can afford it.
+ */
+namespace Voicing {
+
+static const int MAX_VOICES = 16;
+
+enum Extension {
+    EXTEND_THIRDS,
+    EXTEND_OCTAVES,
+    NUM_EXTENSIONS
+};
+
+enum Drop {
+    DROP_NONE,
+    DROP_2,
+    DROP_3,
+    NUM_DROPS
+};
+
+// chord: the four voices as played, 1V/oct. scale, degree and rootVoltage
+// place the stacked thirds. Only out[0] to out[numVoices - 1] are written.
+inline void build(const ScaleLibrary& library, int scale, int degree, float rootVoltage, const float chord[4],
+                  int numVoices, int extension, int drop, float out[MAX_VOICES]) {
+    for (int k = 0; k < numVoices; k++) {
+        if (k < 4) out[k] = chord[k];
+        else if (extension == EXTEND_OCTAVES) out[k] = out[k - 4] + library.period;
+        // Voice k is the (2k + 1)th above the chord root: 9th, 11th, 13th
+        else if (k < 7) out[k] = rootVoltage + library.getScaleVoltage(scale, degree + 2 * k);
+        else out[k] = out[k - 7] + library.period;
+    }
+
+    int nth = (drop == DROP_2) ? 2 : (drop == DROP_3) ? 3 : 0;
+    if (nth == 0 || numVoices < nth) return;
+    // Rank by pitch, equal pitches by channel
+    for (int i = 0; i < numVoices; i++) {
+        int higher = 0;
+        for (int j = 0; j < numVoices; j++)
+            higher += (out[j] > out[i]) || (out[j] == out[i] && j < i);
+        if (higher == nth - 1) {
+            out[i] -= library.period;
+            return;
+        }
+    }
+}
+
+} // namespace Voicing
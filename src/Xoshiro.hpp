@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Xoshiro.hpp
+ * xoshiro128++ (Blackman & Vigna): a small, fast PRNG with 128 bits of state.
+ * Each module instance owns one, so its random sequence depends only on its
+ * own seed and can be reproduced from a saved patch.
+ */
+struct Xoshiro128 {
+    uint32_t s[4];
+
+    Xoshiro128(uint64_t seed = 0) {
+        setSeed(seed);
+    }
+
+    // Expands a 64-bit seed with splitmix64, which never yields the
+    // all-zero state xoshiro cannot leave.
+    void setSeed(uint64_t seed) {
+        for (int i = 0; i < 4; i += 2) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z ^= z >> 31;
+            s[i] = (uint32_t) z;
+            s[i + 1] = (uint32_t) (z >> 32);
+        }
+    }
+
+    static uint32_t rotl(uint32_t x, int k) {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    uint32_t next() {
+        uint32_t result = rotl(s[0] + s[3], 7) + s[0];
+        uint32_t t = s[1] << 9;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 11);
+        return result;
+    }
+
+    // Uniform in [0, 1), from the top 24 bits.
+    float uniform() {
+        return (next() >> 8) * (1.f / 16777216.f);
+    }
+};
@@ -1,10 +1,14 @@
 #include "plugin.hpp"
+#include "ScaleLibrary.hpp"
 
 Plugin* pluginInstance;
 
 void init(Plugin* p) {
 	pluginInstance = p;
 
+	// Built-in and user scales, shared by every instance
+	ScaleLibrary::reload();
+
 	// This is the line that was likely missing or mismatched!
 	p->addModel(modelChordCircle);
 }
\ No newline at end of file